@@ -0,0 +1,226 @@
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "batch_6502.h"
+#include "pool_6502.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+	using namespace m6502;
+
+	/* The jobs a thread has left: it takes them from the front, the others steal from the back */
+	struct WorkQueue
+	{
+		std::mutex Lock;
+		std::deque<u32> Jobs;
+
+		bool Pop(u32& Job, bool Steal)
+		{
+			std::lock_guard<std::mutex> Guard(Lock);
+			if (Jobs.empty())
+			{
+				return false;
+			}
+			Job = Steal ? Jobs.back() : Jobs.front();
+			Steal ? Jobs.pop_back() : Jobs.pop_front();
+			return true;
+		}
+	};
+
+	/* The processors a thread may run on */
+	struct Affinity
+	{
+#if defined(_WIN32)
+		DWORD_PTR Mask = 0;
+#else
+		cpu_set_t Set;
+#endif
+
+		/* @return the calling thread's (the process's on Windows, which only tells a thread's by setting it) */
+		static Affinity Current()
+		{
+			Affinity Each;
+#if defined(_WIN32)
+			DWORD_PTR System;
+			GetProcessAffinityMask(GetCurrentProcess(), &Each.Mask, &System);
+#else
+			CPU_ZERO(&Each.Set);
+			pthread_getaffinity_np(pthread_self(), sizeof(Each.Set), &Each.Set);
+#endif
+			return Each;
+		}
+
+		/* @return the processors, in order */
+		std::vector<u32> Processors() const
+		{
+			std::vector<u32> Found;
+#if defined(_WIN32)
+			for (u32 Processor = 0; Processor < 8 * sizeof(Mask); Processor++)
+			{
+				if ((Mask >> Processor) & 1)
+#else
+			for (u32 Processor = 0; Processor < CPU_SETSIZE; Processor++)
+			{
+				if (CPU_ISSET(Processor, &Set))
+#endif
+				{
+					Found.push_back(Processor);
+				}
+			}
+			return Found;
+		}
+
+		/* Restricts the calling thread to these processors, best effort */
+		void Apply() const
+		{
+#if defined(_WIN32)
+			SetThreadAffinityMask(GetCurrentThread(), Mask);
+#else
+			pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set);
+#endif
+		}
+
+		/* @return just Processor */
+		static Affinity Only(u32 Processor)
+		{
+			Affinity One;
+#if defined(_WIN32)
+			One.Mask = DWORD_PTR(1) << Processor;
+#else
+			CPU_ZERO(&One.Set);
+			CPU_SET(Processor, &One.Set);
+#endif
+			return One;
+		}
+	};
+
+	void RunJob(const BatchJob& Job, Machine& machine, BatchResult& Result)
+	{
+		CPU& cpu = machine.cpu;
+		Mem& memory = machine.memory;
+		if (Job.Program)
+		{
+			cpu.LoadPrg(Job.Program->Data(), Job.Program->Size(), memory);
+		}
+		cpu.PC = Job.Start.PC;
+		cpu.SP = Job.Start.SP;
+		cpu.A = Job.Start.A;
+		cpu.X = Job.Start.X;
+		cpu.Y = Job.Start.Y;
+		cpu.PS.Reg = Job.Start.PS;
+		cpu.UnpackStatus();
+
+		try
+		{
+			Result.CyclesUsed = cpu.Execute(Job.Cycles, memory);
+		}
+		catch (...)
+		{
+			Result.Failed = true;
+		}
+
+		Result.End.PC = cpu.PC;
+		Result.End.SP = cpu.SP;
+		Result.End.A = cpu.A;
+		Result.End.X = cpu.X;
+		Result.End.Y = cpu.Y;
+		Result.End.PS = cpu.PS.Reg;
+		Result.Ranges.resize(Job.Ranges.size());
+		for (std::size_t i = 0; i < Job.Ranges.size(); i++)
+		{
+			const BatchRange& Range = Job.Ranges[i];
+			const u32 Count = (Range.Count > Mem::MAX_MEM - Range.First) ? Mem::MAX_MEM - Range.First : Range.Count;
+			Result.Ranges[i].assign(&memory.Data[Range.First], &memory.Data[Range.First] + Count);
+		}
+	}
+
+	void Work(const std::vector<BatchJob>& Jobs, std::vector<BatchResult>& Results, std::vector<WorkQueue>& Queues, u32 Self,
+		const std::vector<u32>& PinTo)
+	{
+		s32 Node = InstancePool::ANY_NODE;
+		if (!PinTo.empty())
+		{
+			Affinity::Only(PinTo[Self % PinTo.size()]).Apply();
+			Node = InstancePool::CurrentNode();
+		}
+		// one machine per thread, recycled from job to job
+		InstancePool Pool(1, false, Node);
+		const u32 Threads = static_cast<u32>(Queues.size());
+		u32 Job;
+		for (;;)
+		{
+			bool Found = Queues[Self].Pop(Job, false);
+			for (u32 Other = 1; !Found && Other < Threads; Other++)
+			{
+				Found = Queues[(Self + Other) % Threads].Pop(Job, true);
+			}
+			if (!Found)
+			{
+				return;
+			}
+			Machine* machine = Pool.Acquire();
+			if (!machine)
+			{
+				// the OS has no memory for a machine, the job cannot run
+				Results[Job].Failed = true;
+				continue;
+			}
+			RunJob(Jobs[Job], *machine, Results[Job]);
+			Pool.Release(machine);
+		}
+	}
+}
+
+std::vector<m6502::BatchResult> m6502::RunBatch(const std::vector<BatchJob>& Jobs, u32 Threads, BatchPlacement Placement)
+{
+	if (Threads == 0)
+	{
+		Threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+	}
+	if (Threads > Jobs.size())
+	{
+		Threads = Jobs.size() ? static_cast<u32>(Jobs.size()) : 1;
+	}
+
+	std::vector<BatchResult> Results(Jobs.size());
+	std::vector<WorkQueue> Queues(Threads);
+	for (u32 Job = 0; Job < Jobs.size(); Job++)
+	{
+		// neighbouring jobs on the same thread, they tend to run the same program
+		Queues[static_cast<u64>(Job) * Threads / Jobs.size()].Jobs.push_back(Job);
+	}
+
+	const Affinity Caller = Affinity::Current();
+	std::vector<u32> PinTo;
+	if (Placement == BatchPlacement::Pinned)
+	{
+		PinTo = Caller.Processors();
+	}
+
+	std::vector<std::thread> Workers;
+	for (u32 Self = 1; Self < Threads; Self++)
+	{
+		Workers.emplace_back(Work, std::cref(Jobs), std::ref(Results), std::ref(Queues), Self, std::cref(PinTo));
+	}
+	Work(Jobs, Results, Queues, 0, PinTo);
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+	if (!PinTo.empty())
+	{
+		Caller.Apply();
+	}
+	return Results;
+}
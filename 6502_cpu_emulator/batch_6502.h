@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "main_6502.h"
+#include "rom_image_6502.h"
+
+/* The registers a BatchJob starts from and a BatchResult ends with */
+struct m6502::BatchRegisters
+{
+	Word PC = 0;
+	Byte SP = 0xFF;
+	Byte A = 0, X = 0, Y = 0;
+	Byte PS = 0;
+};
+
+/* Memory a BatchResult brings back, Count bytes from First */
+struct m6502::BatchRange
+{
+	Word First;
+	u32 Count;
+};
+
+/* A program to run on a machine of its own */
+struct m6502::BatchJob
+{
+	std::shared_ptr<const RomImage> Program;	// .prg image, jobs running the same one share it
+	BatchRegisters Start;
+	s32 Cycles = 0;
+	std::vector<BatchRange> Ranges;
+};
+
+struct m6502::BatchResult
+{
+	BatchRegisters End;
+	s32 CyclesUsed = 0;
+	bool Failed = false;		// ran into an instruction that is not handled (End is where), or no memory for a machine
+	std::vector<std::vector<Byte>> Ranges;	// one per BatchJob::Ranges, cut at $FFFF
+};
+
+namespace m6502
+{
+	/* Where RunBatch runs its threads and puts their machines */
+	enum class BatchPlacement : Byte
+	{
+		Any,		// where the OS sees fit
+		Pinned,		// thread i on the i-th processor the process may run on, its machines on the NUMA node of that processor
+	};
+
+	/** Runs Jobs, each on a machine of its own, on Threads threads (0: one per hardware thread).
+	*	Every thread starts with an equal share of the jobs and, once out of them, takes the
+	*	last one left to another thread, so long jobs do not hold the batch up.
+	*	The calling thread is one of them, Pinned gives it its own affinity back on return.
+	*	@return the results in the order of Jobs */
+	std::vector<BatchResult> RunBatch(const std::vector<BatchJob>& Jobs, u32 Threads = 0,
+		BatchPlacement Placement = BatchPlacement::Any);
+}
@@ -0,0 +1,121 @@
+#include "c64_banking_6502.h"
+
+namespace
+{
+	using namespace m6502;
+
+	constexpr u32 BASIC_PAGE = 0xA0;
+	constexpr u32 IO_PAGE = 0xD0;
+	constexpr u32 KERNAL_PAGE = 0xE0;
+	constexpr u32 IO_PAGES = 0x10;
+}
+
+m6502::C64Banking::C64Banking(Mem& memory, const Byte* Basic, const Byte* Kernal, const Byte* Char, IoDevice* Io)
+	: Memory(memory), Basic(Basic), Kernal(Kernal), Char(Char), Io(Io)
+{
+	Memory.MapPort(this);
+	Reset();
+}
+
+m6502::C64Banking::C64Banking(Mem& memory, const C64Roms& Roms, IoDevice* Io)
+	: C64Banking(memory, Roms.Basic->Data(), Roms.Kernal->Data(), Roms.Char->Data(), Io)
+{
+	Images[0] = Roms.Basic;
+	Images[1] = Roms.Kernal;
+	Images[2] = Roms.Char;
+}
+
+m6502::C64Banking::~C64Banking()
+{
+	Memory.MapPort(nullptr);
+	Memory.MapRam(BASIC_PAGE, BASIC_SIZE / Mem::PAGE_SIZE);
+	Memory.MapRam(IO_PAGE, IO_PAGES);
+	Memory.MapRam(KERNAL_PAGE, KERNAL_SIZE / Mem::PAGE_SIZE);
+}
+
+void m6502::C64Banking::Reset()
+{
+	Direction = 0;
+	Port = 0;
+	Apply();
+}
+
+m6502::Byte m6502::C64Banking::Read(Word Address)
+{
+	return Memory.Data[Address];
+}
+
+void m6502::C64Banking::Write(Word Address, Byte Value)
+{
+	if (Address == 0x0000)
+	{
+		Direction = Value;
+	}
+	else
+	{
+		Port = Value;
+	}
+	Apply();
+}
+
+void m6502::C64Banking::Apply()
+{
+	// what the CPU reads back from the port
+	const Byte Selected = Lines();
+	Memory[0x0000] = Direction;
+	Memory[0x0001] = Selected;
+
+	// the PLA, pages that stay the same are left alone (see Mem::MapPage)
+	const bool Loram = Selected & LORAM;
+	const bool Hiram = Selected & HIRAM;
+
+	if (Loram && Hiram)
+	{
+		Memory.MapRom(BASIC_PAGE, BASIC_SIZE / Mem::PAGE_SIZE, Basic);
+	}
+	else
+	{
+		Memory.MapRam(BASIC_PAGE, BASIC_SIZE / Mem::PAGE_SIZE);
+	}
+
+	if (Hiram)
+	{
+		Memory.MapRom(KERNAL_PAGE, KERNAL_SIZE / Mem::PAGE_SIZE, Kernal);
+	}
+	else
+	{
+		Memory.MapRam(KERNAL_PAGE, KERNAL_SIZE / Mem::PAGE_SIZE);
+	}
+
+	if (!Loram && !Hiram)
+	{
+		Memory.MapRam(IO_PAGE, IO_PAGES);
+	}
+	else if (!(Selected & CHAREN))
+	{
+		Memory.MapRom(IO_PAGE, CHAR_SIZE / Mem::PAGE_SIZE, Char);
+	}
+	else if (Io)
+	{
+		Memory.MapIo(IO_PAGE, IO_PAGES, Io);
+	}
+	else
+	{
+		Memory.MapRam(IO_PAGE, IO_PAGES);
+	}
+}
+
+bool m6502::C64Roms::Open(const char* BasicPath, const char* KernalPath, const char* CharPath)
+{
+	Basic = RomImage::Share(BasicPath);
+	Kernal = RomImage::Share(KernalPath);
+	Char = RomImage::Share(CharPath);
+	if (!Basic || Basic->Size() != C64Banking::BASIC_SIZE
+		|| !Kernal || Kernal->Size() != C64Banking::KERNAL_SIZE
+		|| !Char || Char->Size() != C64Banking::CHAR_SIZE)
+	{
+		*this = C64Roms();
+		return false;
+	}
+	return true;
+}
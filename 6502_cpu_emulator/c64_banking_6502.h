@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include "main_6502.h"
+#include "rom_image_6502.h"
+
+/** C64 memory configuration: the 6510 on-chip port at $00/$01 and the PLA.
+*	Writing the port switches BASIC ($A000), KERNAL ($E000) and the CHAR ROM or
+*	I/O ($D000) in and out by repointing pages of memory (see Mem::MapRom),
+*	nothing is copied. Only the writes of $00/$01 come here (Mem::MapPort), the
+*	rest of page 0 stays plain RAM and reads of $00/$01 get what the port put there.
+*	The ROM images and Io must outlive the mapping; Io may be nullptr, the
+*	I/O area is RAM then. No cartridge (EXROM and GAME high).
+*	A copy of the Mem keeps the banks mapped but has no port: build another
+*	C64Banking on it to switch its banks. */
+struct m6502::C64Banking : IoDevice
+{
+	static constexpr u32 BASIC_SIZE = 8 * 1024;
+	static constexpr u32 KERNAL_SIZE = 8 * 1024;
+	static constexpr u32 CHAR_SIZE = 4 * 1024;
+
+	static constexpr Byte LORAM = 1 << 0;		// BASIC in at $A000 (with HIRAM)
+	static constexpr Byte HIRAM = 1 << 1;		// KERNAL in at $E000
+	static constexpr Byte CHAREN = 1 << 2;		// I/O at $D000 instead of the CHAR ROM
+	static constexpr Byte INPUT_LINES = 0x17;	// port lines pulled up when they are inputs
+
+	C64Banking(Mem& memory, const Byte* Basic, const Byte* Kernal, const Byte* Char, IoDevice* Io);
+
+	/* Maps the shared images of Roms, which must have been opened, and keeps them alive */
+	C64Banking(Mem& memory, const C64Roms& Roms, IoDevice* Io);
+	~C64Banking() override;
+	C64Banking(const C64Banking&) = delete;
+	C64Banking& operator=(const C64Banking&) = delete;
+
+	/* Power-up state: every port line an input, so the lines read high (BASIC, KERNAL and I/O in).
+	*	CPU::Reset clears the RAM, call this after it to have the port in $00/$01 again. */
+	void Reset();
+
+	/* @return the port lines that select the banks, outputs as written and inputs pulled up */
+	Byte Lines() const
+	{
+		return (Port & Direction) | (INPUT_LINES & ~Direction);
+	}
+
+	Byte Read(Word Address) override;
+	void Write(Word Address, Byte Value) override;
+
+	const Mem* BoundTo() const override
+	{
+		return &Memory;
+	}
+
+	Byte Direction = 0;		// $00, 1 per output line
+	Byte Port = 0;			// $01, as written
+
+private:
+	/* Maps the banks Lines() selects */
+	void Apply();
+
+	Mem& Memory;
+	const Byte* Basic;
+	const Byte* Kernal;
+	const Byte* Char;
+	IoDevice* Io;
+	std::shared_ptr<const RomImage> Images[3];	// the C64Roms mapped, if any
+};
+
+/** The BASIC, KERNAL and CHAR ROMs, mapped from their files once for every C64Banking
+*	built from them: instances only pay for their RAM, not for a copy of the ROMs. */
+struct m6502::C64Roms
+{
+	std::shared_ptr<const RomImage> Basic;
+	std::shared_ptr<const RomImage> Kernal;
+	std::shared_ptr<const RomImage> Char;
+
+	/* Shares the images of the files (see RomImage::Share).
+	*	@return false, leaving the ROMs empty, if one cannot be opened or is not the size of its ROM */
+	bool Open(const char* BasicPath, const char* KernalPath, const char* CharPath);
+};
@@ -0,0 +1,54 @@
+#include "cpu_pool_6502.h"
+
+void m6502::CPUView::Reset(Mem& memory, Word InitAddress)
+{
+	CPU cpu;
+	cpu.Reset(memory, InitAddress);
+	Set(cpu);
+	CyclesRun = 0;
+}
+
+m6502::s32 m6502::CPUView::Execute(s32 Cycles, Mem& memory)
+{
+	CPU cpu;
+	Get(cpu);
+	const s32 Used = cpu.Execute(Cycles, memory);
+	Set(cpu);
+	CyclesRun += Used;
+	return Used;
+}
+
+void m6502::CPUView::Get(CPU& cpu) const
+{
+	cpu.PC = PC;
+	cpu.SP = SP;
+	cpu.A = A;
+	cpu.X = X;
+	cpu.Y = Y;
+	cpu.PS = PS;
+	cpu.UnpackStatus();
+}
+
+void m6502::CPUView::Set(const CPU& cpu)
+{
+	PC = cpu.PC;
+	SP = cpu.SP;
+	A = cpu.A;
+	X = cpu.X;
+	Y = cpu.Y;
+	PS = cpu.PS;
+}
+
+m6502::u32 m6502::CPUPool::Add(const CPU& cpu)
+{
+	PC.push_back(0);
+	SP.push_back(0);
+	A.push_back(0);
+	X.push_back(0);
+	Y.push_back(0);
+	PS.push_back(PSUnion());
+	CyclesRun.push_back(0);
+	const u32 Index = Size() - 1;
+	(*this)[Index].Set(cpu);
+	return Index;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include "main_6502.h"
+
+/* One CPU of a CPUPool: the registers by reference, and the CPU functions that run it */
+struct m6502::CPUView
+{
+	Word& PC;
+	Byte& SP;
+	Byte& A;
+	Byte& X;
+	Byte& Y;
+	PSUnion& PS;
+	u64& CyclesRun;		// cycles used by Execute since Reset
+
+	/* Same as CPU::Reset */
+	void Reset(Mem& memory, Word InitAddress = 0xFFFC);
+
+	/* Same as CPU::Execute, on a CPU loaded from the pool and stored back */
+	s32 Execute(s32 Cycles, Mem& memory);
+
+	/* Copies the registers to cpu, or from it */
+	void Get(CPU& cpu) const;
+	void Set(const CPU& cpu);
+};
+
+/** The registers of many CPUs, one array per register, so a pass over one
+*	register of all of them (scheduling, statistics, snapshots) reads contiguous
+*	memory instead of a CPU in every Machine, 80 KB apart. pool[i] is a CPUView
+*	used like a CPU; Execute runs a CPU loaded from the arrays and stores it back.
+*	The state of the idle loop detection is not kept between two Executes. */
+struct m6502::CPUPool
+{
+	/* Adds a CPU with cpu's registers, @return its index */
+	u32 Add(const CPU& cpu);
+
+	/* @return the number of CPUs */
+	u32 Size() const
+	{
+		return static_cast<u32>(PC.size());
+	}
+
+	CPUView operator[](u32 Index)
+	{
+		return { PC[Index], SP[Index], A[Index], X[Index], Y[Index], PS[Index], CyclesRun[Index] };
+	}
+
+	std::vector<Word> PC;
+	std::vector<Byte> SP;
+	std::vector<Byte> A;
+	std::vector<Byte> X;
+	std::vector<Byte> Y;
+	std::vector<PSUnion> PS;
+	std::vector<u64> CyclesRun;
+};
@@ -0,0 +1,219 @@
+#include "decode_cache_6502.h"
+#include "opcodes_6502.h"
+
+namespace
+{
+	using namespace m6502;
+
+	/* Runs the micro-op with its handler known at compile time, so it can be inlined */
+	template <OpHandler Handler>
+	inline void Run(CPU& cpu, s32& Cycles, Mem& memory, const MicroOp& Op)
+	{
+		cpu.PC += Op.Length;
+		Cycles -= Op.Cycles;
+		Handler(cpu, Cycles, memory, Op.Operand);
+	}
+
+	template <OpHandler First, OpHandler Second>
+	const MicroOp* Fuse(CPU& cpu, s32& Cycles, Mem& memory, const MicroOp* Op)
+	{
+		Run<First>(cpu, Cycles, memory, Op[0]);
+		if (Cycles <= 0) return Op + 1;
+		Run<Second>(cpu, Cycles, memory, Op[1]);
+		return Op + 2;
+	}
+
+	template <OpHandler First, OpHandler Second, OpHandler Third>
+	const MicroOp* Fuse(CPU& cpu, s32& Cycles, Mem& memory, const MicroOp* Op)
+	{
+		Run<First>(cpu, Cycles, memory, Op[0]);
+		if (Cycles <= 0) return Op + 1;
+		Run<Second>(cpu, Cycles, memory, Op[1]);
+		if (Cycles <= 0) return Op + 2;
+		Run<Third>(cpu, Cycles, memory, Op[2]);
+		return Op + 3;
+	}
+
+	/* Instruction sequences run as one micro-op, picked from the pair report of
+	*	6502_cpu_emulator_BENCH --pairs. None of them writes memory before its last
+	*	instruction, so a block still ends right after a write to its own page. */
+	struct Fusion
+	{
+		Byte Count;
+		Byte Opcodes[3];
+		FusedHandler Handler;
+	};
+
+	const Fusion Fusions[] = {
+		{ 3, { CPU::INS_INX, CPU::INS_CMX_IM, CPU::INS_BNE }, Fuse<Ops::Op_INX, Ops::Op_CMX_IM, Ops::Op_BNE> },
+		{ 3, { CPU::INS_INY, CPU::INS_CMY_IM, CPU::INS_BNE }, Fuse<Ops::Op_INY, Ops::Op_CMY_IM, Ops::Op_BNE> },
+		{ 2, { CPU::INS_LDA_IM, CPU::INS_STA_ZP }, Fuse<Ops::Op_LDA_IM, Ops::Op_STA_ZP> },
+		{ 2, { CPU::INS_LDA_IM, CPU::INS_STA_ABS }, Fuse<Ops::Op_LDA_IM, Ops::Op_STA_ABS> },
+		{ 2, { CPU::INS_LDA_ZP, CPU::INS_STA_ZP }, Fuse<Ops::Op_LDA_ZP, Ops::Op_STA_ZP> },
+		{ 2, { CPU::INS_LDA_ZP, CPU::INS_STA_ABS }, Fuse<Ops::Op_LDA_ZP, Ops::Op_STA_ABS> },
+		{ 2, { CPU::INS_LDA_ABS, CPU::INS_STA_ZP }, Fuse<Ops::Op_LDA_ABS, Ops::Op_STA_ZP> },
+		{ 2, { CPU::INS_LDA_ABS, CPU::INS_STA_ABS }, Fuse<Ops::Op_LDA_ABS, Ops::Op_STA_ABS> },
+		{ 2, { CPU::INS_DEX, CPU::INS_BNE }, Fuse<Ops::Op_DEX, Ops::Op_BNE> },
+		{ 2, { CPU::INS_DEY, CPU::INS_BNE }, Fuse<Ops::Op_DEY, Ops::Op_BNE> },
+		{ 2, { CPU::INS_CMP_IM, CPU::INS_BEQ }, Fuse<Ops::Op_CMP_IM, Ops::Op_BEQ> },
+		{ 2, { CPU::INS_CMP_IM, CPU::INS_BNE }, Fuse<Ops::Op_CMP_IM, Ops::Op_BNE> },
+		{ 2, { CPU::INS_CLC, CPU::INS_ADC_IM }, Fuse<Ops::Op_CLC, Ops::Op_ADC_IM> },
+		{ 2, { CPU::INS_CLC, CPU::INS_ADC_ZP }, Fuse<Ops::Op_CLC, Ops::Op_ADC_ZP> },
+		{ 2, { CPU::INS_CLC, CPU::INS_ADC_ABS }, Fuse<Ops::Op_CLC, Ops::Op_ADC_ABS> },
+		{ 2, { CPU::INS_CLC, CPU::INS_ADC_ABSX }, Fuse<Ops::Op_CLC, Ops::Op_ADC_ABSX> },
+	};
+
+	/* Marks the ops starting a fused sequence, Ops ends with a micro-op without handler */
+	void FuseOps(MicroOp* Ops)
+	{
+		for (; Ops->Handler; Ops++)
+		{
+			for (const Fusion& Candidate : Fusions)
+			{
+				u32 i = 0;
+				while (i < Candidate.Count && Ops[i].Handler && Ops[i].Opcode == Candidate.Opcodes[i])
+				{
+					i++;
+				}
+				if (i == Candidate.Count)
+				{
+					Ops->Fused = Candidate.Handler;
+					Ops += Candidate.Count - 1;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void m6502::DecodeCache::CachedPage::Clear(u32 NewVersion)
+{
+	Version = NewVersion;
+	for (u32 i = 0; i < Mem::PAGE_SIZE; i++) {
+		BlockStart[i] = NOT_DECODED;
+	}
+	Ops.clear();
+}
+
+void m6502::DecodeCache::Flush()
+{
+	for (u32 Page = 0; Page < Mem::NUM_PAGES; Page++) {
+		Pages[Page].reset();
+	}
+}
+
+bool m6502::DecodeCache::EndsBlock(Byte Opcode)
+{
+	switch (Opcode)
+	{
+	case CPU::INS_BEQ:
+	case CPU::INS_BNE:
+	case CPU::INS_BCS:
+	case CPU::INS_BCC:
+	case CPU::INS_BVS:
+	case CPU::INS_BVC:
+	case CPU::INS_BMI:
+	case CPU::INS_BPL:
+	case CPU::INS_JSR:
+	case CPU::INS_RTS:
+	case CPU::INS_JMP_ABS:
+	case CPU::INS_JMP_IND:
+		return true;
+	default:
+		return false;
+	}
+}
+
+m6502::Word m6502::DecodeCache::DecodeBlock(CachedPage& Cached, Word Address, const Mem& memory)
+{
+	const u32 Page = Address / Mem::PAGE_SIZE;
+	const u32 First = static_cast<u32>(Cached.Ops.size());
+	u32 PC = Address;
+	for (u32 i = 0; i < MAX_BLOCK_OPS && PC / Mem::PAGE_SIZE == Page; i++)
+	{
+		MicroOp Op = CPU::Decode(static_cast<Word>(PC), memory);
+		// an instruction spilling into the next page would not be invalidated with this one
+		if (!Op.Handler || (PC + Op.Length - 1) / Mem::PAGE_SIZE != Page)
+		{
+			break;
+		}
+		Cached.Ops.push_back(Op);
+		PC += Op.Length;
+		if (EndsBlock(Op.Opcode))
+		{
+			break;
+		}
+	}
+	if (Cached.Ops.size() == First)
+	{
+		return NOT_DECODABLE;
+	}
+	Cached.Ops.push_back(MicroOp{});
+	FuseOps(&Cached.Ops[First]);
+	return static_cast<Word>(First + 1);
+}
+
+const m6502::MicroOp* m6502::DecodeCache::LookupSlow(Word Address, const Mem& memory)
+{
+	if (memory.Id != MemId)
+	{
+		Flush();
+		MemId = memory.Id;
+	}
+
+	const u32 Page = Address / Mem::PAGE_SIZE;
+	CachedPage* Cached = Pages[Page].get();
+	if (!Cached)
+	{
+		Pages[Page].reset(new CachedPage);
+		Cached = Pages[Page].get();
+		Cached->Clear(memory.PageVersion[Page]);
+	}
+	else if (Cached->Version != memory.PageVersion[Page])
+	{
+		Cached->Clear(memory.PageVersion[Page]);
+	}
+
+	Word& Start = Cached->BlockStart[Address % Mem::PAGE_SIZE];
+	if (Start == NOT_DECODED)
+	{
+		Start = DecodeBlock(*Cached, Address, memory);
+	}
+	return (Start == NOT_DECODABLE) ? nullptr : &Cached->Ops[Start - 1];
+}
+
+/* @return the number of cycles that were used */
+m6502::s32 m6502::CPU::Execute(s32 Cycles, Mem& memory, DecodeCache& Cache)
+{
+	const u32 CycleRequested = Cycles;
+	UnpackStatus();
+	while (Cycles > 0)
+	{
+		const MicroOp* Op = Cache.Lookup(PC, memory);
+		if (!Op)
+		{
+			// unhandled opcode or an instruction across a page boundary
+			Cycles -= Interpret(1, memory);
+			continue;
+		}
+
+		// a write to the block's own page ends it, the rest is decoded again
+		const u32 Page = PC / Mem::PAGE_SIZE;
+		const u32 Version = memory.PageVersion[Page];
+		do
+		{
+			if (Op->Fused)
+			{
+				Op = Op->Fused(*this, Cycles, memory, Op);
+				continue;
+			}
+			PC += Op->Length;
+			Cycles -= Op->Cycles;
+			Op->Handler(*this, Cycles, memory, Op->Operand);
+			Op++;
+		} while (Op->Handler && Cycles > 0 && memory.PageVersion[Page] == Version);
+	}
+	PackStatus();
+	const s32 NumCyclesUsed = CycleRequested - Cycles;
+	return NumCyclesUsed;
+}
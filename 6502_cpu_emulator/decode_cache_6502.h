@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "main_6502.h"
+
+/** Cache of pre-decoded basic blocks, keyed by their start address.
+*	A block is a straight run of instructions inside one page, ending after
+*	a branch, JMP, JSR or RTS. Blocks of a page are dropped as soon as the
+*	page is written (see Mem::PageVersion), so self-modifying code is safe.
+*	Common instruction sequences in a block (LDA/STA, DEX/BNE, CMP/BEQ, CLC/ADC,
+*	INX/CPX/BNE...) are fused into one dispatch, see MicroOp::Fused. */
+struct m6502::DecodeCache
+{
+	static constexpr u32 MAX_BLOCK_OPS = 32;
+
+	DecodeCache() = default;
+	DecodeCache(const DecodeCache&) = delete;
+	DecodeCache& operator=(const DecodeCache&) = delete;
+
+	/** @return the first micro-op of the block starting at Address, terminated by
+	*	a micro-op with a null Handler, or nullptr when nothing can be decoded there */
+	const MicroOp* Lookup(Word Address, const Mem& memory)
+	{
+		const CachedPage* Cached = Pages[Address / Mem::PAGE_SIZE].get();
+		if (Cached && memory.Id == MemId && Cached->Version == memory.PageVersion[Address / Mem::PAGE_SIZE])
+		{
+			const Word Start = Cached->BlockStart[Address % Mem::PAGE_SIZE];
+			if (Start != NOT_DECODED)
+			{
+				return (Start == NOT_DECODABLE) ? nullptr : &Cached->Ops[Start - 1];
+			}
+		}
+		return LookupSlow(Address, memory);
+	}
+
+	/* Drops every decoded block */
+	void Flush();
+
+	/* @return true if the instruction ends a basic block */
+	static bool EndsBlock(Byte Opcode);
+
+private:
+	static constexpr Word NOT_DECODED = 0x0000;
+	static constexpr Word NOT_DECODABLE = 0xFFFF;
+
+	struct CachedPage
+	{
+		u32 Version;
+		Word BlockStart[Mem::PAGE_SIZE];		// index+1 into Ops, or one of the markers above
+		std::vector<MicroOp> Ops;
+
+		void Clear(u32 NewVersion);
+	};
+
+	const MicroOp* LookupSlow(Word Address, const Mem& memory);
+
+	Word DecodeBlock(CachedPage& Cached, Word Address, const Mem& memory);
+
+	u32 MemId = 0;
+	std::unique_ptr<CachedPage> Pages[Mem::NUM_PAGES];
+};
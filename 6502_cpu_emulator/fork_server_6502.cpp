@@ -0,0 +1,492 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "fork_server_6502.h"
+#include "pool_6502.h"
+#include "snapshot_6502.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define M6502_FORK_SERVER 1
+#include <cerrno>
+#include <csignal>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#define M6502_FORK_SERVER 0
+#endif
+
+namespace
+{
+	using namespace m6502;
+
+	/* @return false if Text is not a hex number up to Max */
+	bool ParseHex(const char* Text, u32 Max, u32& Value)
+	{
+		char* End;
+		const unsigned long Parsed = std::strtoul(Text, &End, 16);
+		if (End == Text || *End != '\0' || Parsed > Max)
+		{
+			return false;
+		}
+		Value = static_cast<u32>(Parsed);
+		return true;
+	}
+
+#if M6502_FORK_SERVER
+	bool WriteAll(int Fd, const char* Data, std::size_t Size)
+	{
+		while (Size > 0)
+		{
+			const ssize_t Written = write(Fd, Data, Size);
+			if (Written < 0)
+			{
+				return false;
+			}
+			Data += Written;
+			Size -= static_cast<std::size_t>(Written);
+		}
+		return true;
+	}
+
+	/* Jobs sent to a worker ahead of its answers, so it reads them in batches
+	*	instead of waiting on the server between two jobs */
+	constexpr std::size_t QUEUED = 16;
+
+	/* A process forked from the ready machine, running the jobs sent on Socket in order */
+	struct Worker
+	{
+		pid_t Pid = -1;
+		int Socket = -1;			// -1 if it could not be forked
+		std::deque<std::string> Lines;	// sent, not answered yet
+		std::string Pending;		// answers read from Socket, not written out yet
+		bool Ended = false;			// Socket has nothing more to read
+	};
+
+	/* Sends Line to a worker; one that died makes it fail instead of raising SIGPIPE */
+	bool Send(int Socket, const std::string& Line)
+	{
+		const char* Data = Line.data();
+		std::size_t Size = Line.size();
+		while (Size > 0)
+		{
+#ifdef MSG_NOSIGNAL
+			const ssize_t Sent = send(Socket, Data, Size, MSG_NOSIGNAL);
+#else
+			const ssize_t Sent = write(Socket, Data, Size);
+#endif
+			if (Sent < 0)
+			{
+				return false;
+			}
+			Data += Sent;
+			Size -= static_cast<std::size_t>(Sent);
+		}
+		return true;
+	}
+
+	/* Closes every descriptor but the standard ones and Keep: a worker holding the far end
+	*	of a pipe the server reads (or a sibling's socket) would keep it from ever ending */
+	void CloseAllBut(int Keep)
+	{
+#if defined(__linux__)
+		if (DIR* Open = opendir("/proc/self/fd"))
+		{
+			std::vector<int> Fds;
+			while (const dirent* Entry = readdir(Open))
+			{
+				const int Fd = std::atoi(Entry->d_name);
+				if (Fd > 2 && Fd != Keep && Fd != dirfd(Open))
+				{
+					Fds.push_back(Fd);
+				}
+			}
+			closedir(Open);
+			for (const int Fd : Fds)
+			{
+				close(Fd);
+			}
+			return;
+		}
+#endif
+		const long Max = sysconf(_SC_OPEN_MAX);
+		for (int Fd = 3; Fd < Max; Fd++)
+		{
+			if (Fd != Keep)
+			{
+				close(Fd);
+			}
+		}
+	}
+
+	/* Closes the socket of Job and waits for its process to end */
+	void Stop(Worker& Job)
+	{
+		close(Job.Socket);
+		waitpid(Job.Pid, nullptr, 0);
+		Job.Socket = -1;
+		Job.Pending.clear();
+		Job.Ended = false;
+	}
+#endif
+}
+
+m6502::ForkServer::ForkServer(Machine& Ready, u32 Children)
+	: Ready(Ready), Children(Children ? Children : 1)
+{
+}
+
+std::string m6502::ForkServer::Run(const std::string& Line, CPU& cpu, Mem& memory)
+{
+	std::string Id;
+	s32 Cycles = 1000000;
+	std::vector<std::pair<u32, u32>> Dumps;
+	for (std::size_t First = Line.find_first_not_of(" \t\r"); First != std::string::npos;
+		First = Line.find_first_not_of(" \t\r", First))
+	{
+		const std::size_t Last = Line.find_first_of(" \t\r", First);
+		const std::string Token = Line.substr(First, Last - First);
+		First = Last;
+		const std::size_t Equals = Token.find('=');
+		const std::string Key = Token.substr(0, Equals);
+		const std::string Value = (Equals == std::string::npos) ? "" : Token.substr(Equals + 1);
+		Byte* Register = (Key == "A") ? &cpu.A : (Key == "X") ? &cpu.X : (Key == "Y") ? &cpu.Y
+			: (Key == "SP") ? &cpu.SP : (Key == "PS") ? &cpu.PS.Reg : nullptr;
+		u32 Parsed = 0;
+		bool Good = true;
+		if (Key == "id")
+		{
+			Id = Value;
+		}
+		else if (Key == "cycles")
+		{
+			Good = std::sscanf(Value.c_str(), "%d", &Cycles) == 1 && Cycles > 0;
+		}
+		else if (Register)
+		{
+			Good = ParseHex(Value.c_str(), 0xFF, Parsed);
+			*Register = static_cast<Byte>(Parsed);
+		}
+		else if (Key == "PC")
+		{
+			Good = ParseHex(Value.c_str(), 0xFFFF, Parsed);
+			cpu.PC = static_cast<Word>(Parsed);
+		}
+		else if (Key == "dump")
+		{
+			unsigned First = 0, Count = 0;
+			Good = std::sscanf(Value.c_str(), "%x:%u", &First, &Count) == 2 && First < Mem::MAX_MEM;
+			Dumps.emplace_back(First, (Good && Count > Mem::MAX_MEM - First) ? Mem::MAX_MEM - First : Count);
+		}
+		else
+		{
+			return "error unknown key " + Key + "\n";
+		}
+		if (!Good)
+		{
+			return "error bad value " + Token + "\n";
+		}
+	}
+
+	bool Failed = false;
+	s32 Used = 0;
+	try
+	{
+		Used = cpu.Execute(Cycles, memory);
+	}
+	catch (...)
+	{
+		Failed = true;
+	}
+
+	char Registers[96];
+	std::snprintf(Registers, sizeof(Registers), "A=%02X X=%02X Y=%02X SP=%02X PC=%04X PS=%02X cycles=%d%s",
+		cpu.A, cpu.X, cpu.Y, cpu.SP, cpu.PC, cpu.PS.Reg, Used, Failed ? " failed" : "");
+	std::string Result = Id.empty() ? Registers : "id=" + Id + " " + Registers;
+	const Mem& Dumped = memory;	// reads only, they are no writes for the dirty map
+	for (const std::pair<u32, u32>& Dump : Dumps)
+	{
+		static const char HEX[] = "0123456789ABCDEF";
+		Result += ' ';
+		for (u32 Address = Dump.first; Address < Dump.first + Dump.second; Address++)
+		{
+			Result += HEX[Dumped[Address] >> 4];
+			Result += HEX[Dumped[Address] & 0xF];
+		}
+	}
+	return Result + "\n";
+}
+
+bool m6502::ForkServer::Serve(int In, int Out)
+{
+#if M6502_FORK_SERVER
+	std::vector<Worker> Workers;
+	std::deque<u32> Order;		// the worker of each job not answered yet
+
+	// forks Job from Ready as it is now and sends it the lines it had left, if any
+	auto Spawn = [&](Worker& Job)
+	{
+		int Ends[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, Ends) != 0)
+		{
+			return;
+		}
+		const pid_t Pid = fork();
+		if (Pid == 0)
+		{
+			// the worker: the ready machine is ours, copied page by page as the jobs write it
+			CloseAllBut(Ends[1]);
+			const MemSnapshot Image(Ready.memory);
+			const CPU Start = Ready.cpu;
+			const u32 MapVersion = Ready.memory.MapVersion;
+			const u32 DeviceAccesses = Ready.memory.DeviceAccesses;
+			std::string Pending, Answers;
+			for (;;)
+			{
+				const std::size_t End = Pending.find('\n');
+				if (End == std::string::npos)
+				{
+					// the answers go out once the lines at hand are done
+					char Buffer[4096];
+					ssize_t Read;
+					if (!WriteAll(Ends[1], Answers.data(), Answers.size())
+						|| (Read = read(Ends[1], Buffer, sizeof(Buffer))) <= 0)
+					{
+						break;
+					}
+					Answers.clear();
+					Pending.append(Buffer, static_cast<std::size_t>(Read));
+					continue;
+				}
+				const std::string Result = Run(Pending.substr(0, End), Ready.cpu, Ready.memory);
+				Pending.erase(0, End + 1);
+				Image.Restore(Ready.memory);
+				Ready.cpu = Start;
+				// a bank switch, a port or a device register is more than the snapshot brings back
+				const bool Retire = Ready.memory.MapVersion != MapVersion
+					|| Ready.memory.DeviceAccesses != DeviceAccesses;
+				Answers += Retire ? '-' : '+';
+				Answers += Result;
+				if (Retire)
+				{
+					WriteAll(Ends[1], Answers.data(), Answers.size());
+					break;
+				}
+			}
+			_exit(0);
+		}
+		close(Ends[1]);
+		if (Pid < 0)
+		{
+			close(Ends[0]);
+			return;
+		}
+		Job.Pid = Pid;
+		Job.Socket = Ends[0];
+		for (const std::string& Line : Job.Lines)
+		{
+			Send(Job.Socket, Line + "\n");
+		}
+	};
+
+	// @return true once the oldest job of Job can be answered
+	auto Done = [](const Worker& Job)
+	{
+		return Job.Socket < 0 || Job.Ended || Job.Pending.find('\n') != std::string::npos;
+	};
+	// @return the result of the oldest job, once Done
+	auto Answer = [&]()
+	{
+		Worker& Job = Workers[Order.front()];
+		Order.pop_front();
+		Job.Lines.pop_front();
+		if (Job.Socket < 0)
+		{
+			return std::string("error no fork\n");
+		}
+		const std::size_t End = Job.Pending.find('\n');
+		const bool Whole = End != std::string::npos && End > 0 && (Job.Pending[0] == '+' || Job.Pending[0] == '-');
+		const std::string Result = Whole ? Job.Pending.substr(1, End) : "error job died\n";
+		if (Whole && Job.Pending[0] == '+')
+		{
+			Job.Pending.erase(0, End + 1);
+		}
+		else
+		{
+			// retired or dead, a new fork takes the jobs it had left
+			Stop(Job);
+			if (!Job.Lines.empty())
+			{
+				Spawn(Job);
+			}
+		}
+		return Result;
+	};
+
+	std::string Pending, Output;
+	bool Good = true, Ended = false;
+	u32 Next = 0;			// the worker of the next job, in turn
+	for (;;)
+	{
+		while (!Order.empty() && Done(Workers[Order.front()]))
+		{
+			Output += Answer();
+		}
+		if (!WriteAll(Out, Output.data(), Output.size()))
+		{
+			Good = false;
+			break;
+		}
+		Output.clear();
+
+		// hands out every line read while the next worker has room for it
+		std::size_t End;
+		while ((End = Pending.find('\n')) != std::string::npos
+			&& (Next == Workers.size() || Workers[Next].Lines.size() < QUEUED))
+		{
+			const std::string Line = Pending.substr(0, End);
+			Pending.erase(0, End + 1);
+			if (Line.find_first_not_of(" \t\r") == std::string::npos)
+			{
+				continue;
+			}
+			if (Next == Workers.size())
+			{
+				Workers.emplace_back();
+			}
+			Worker& Job = Workers[Next];
+			if (Job.Socket < 0 && Job.Lines.empty())
+			{
+				Spawn(Job);
+			}
+			Job.Lines.push_back(Line);
+			Order.push_back(Next);
+			if (Job.Socket >= 0)
+			{
+				// a worker that cannot take the line answers as a job that died
+				Send(Job.Socket, Line + "\n");
+			}
+			Next = (Next + 1) % Children;
+		}
+		if (Ended && Order.empty())
+		{
+			break;
+		}
+		if (!Order.empty() && Done(Workers[Order.front()]))
+		{
+			continue;	// a line no worker could be forked for
+		}
+
+		// waits for more lines, if there is room for them, or for the answers
+		std::vector<pollfd> Polls;
+		const bool Room = Next == Workers.size() || Workers[Next].Lines.size() < QUEUED;
+		if (!Ended && Room)
+		{
+			Polls.push_back(pollfd{ In, POLLIN, 0 });
+		}
+		for (const Worker& Job : Workers)
+		{
+			if (Job.Socket >= 0 && !Job.Ended && !Job.Lines.empty())
+			{
+				Polls.push_back(pollfd{ Job.Socket, POLLIN, 0 });
+			}
+		}
+		if (poll(Polls.data(), Polls.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			Good = false;
+			break;
+		}
+		for (const pollfd& Polled : Polls)
+		{
+			if (!Polled.revents)
+			{
+				continue;
+			}
+			char Buffer[4096];
+			const ssize_t Read = read(Polled.fd, Buffer, sizeof(Buffer));
+			if (Polled.fd == In && Read <= 0)
+			{
+				// the last line needs no '\n'
+				Ended = true;
+				Good = Read == 0;
+				Pending += (Pending.empty() || Pending.back() == '\n') ? "" : "\n";
+			}
+			else if (Polled.fd == In)
+			{
+				Pending.append(Buffer, static_cast<std::size_t>(Read));
+			}
+			else
+			{
+				for (Worker& Job : Workers)
+				{
+					if (Job.Socket == Polled.fd)
+					{
+						Job.Ended = Read <= 0;
+						Job.Pending.append(Buffer, Read > 0 ? static_cast<std::size_t>(Read) : 0);
+					}
+				}
+			}
+		}
+	}
+	for (Worker& Job : Workers)
+	{
+		if (Job.Socket >= 0)
+		{
+			Stop(Job);
+		}
+	}
+	return Good;
+#else
+	(void)In, (void)Out;
+	return false;
+#endif
+}
+
+bool m6502::ForkServer::Listen(const char* Path)
+{
+#if M6502_FORK_SERVER
+	sockaddr_un Address = {};
+	Address.sun_family = AF_UNIX;
+	if (std::strlen(Path) >= sizeof(Address.sun_path))
+	{
+		return false;
+	}
+	std::strcpy(Address.sun_path, Path);
+	const int Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (Socket < 0)
+	{
+		return false;
+	}
+	unlink(Path);
+	if (bind(Socket, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address)) != 0 || listen(Socket, 16) != 0)
+	{
+		close(Socket);
+		return false;
+	}
+	// a client that leaves early must not take the server with it
+	std::signal(SIGPIPE, SIG_IGN);
+	for (;;)
+	{
+		const int Connection = accept(Socket, nullptr, nullptr);
+		if (Connection < 0)
+		{
+			close(Socket);
+			return false;
+		}
+		Serve(Connection, Connection);
+		close(Connection);
+	}
+#else
+	(void)Path;
+	return false;
+#endif
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include "main_6502.h"
+
+/** Serves jobs from a machine booted once (program loaded, registers set): Serve forks
+*	worker processes from it when it starts, each one shares the ready machine with the
+*	server until it writes a page, and after every job a worker puts back the pages the job
+*	wrote (MemSnapshot) and the registers, so a job costs its run and not a new process.
+*	Each worker has a few jobs queued ahead, answers go out as soon as the oldest is done.
+*	A job that remaps memory or touches a device (the C64 port included) retires its
+*	worker, a new one is forked: the snapshot only brings back the RAM.
+*	A job is a line of KEY=VALUE words, the same keys a result prints: A, X, Y, SP, PS, PC
+*	in hex set the registers, cycles=N the budget (1000000), dump=FIRST:COUNT a range
+*	to bring back (FIRST in hex), id=WORD is printed back first. Missing registers keep
+*	the ready value. The result is one line,
+*		[id=WORD] A=.. X=.. Y=.. SP=.. PC=.... PS=.. cycles=N [failed] [hex of each dump]
+*	or "error ..." for a line that does not parse; results come in the order of the jobs.
+*	Forking needs a POSIX system, elsewhere Serve and Listen return false. */
+struct m6502::ForkServer
+{
+	/* Serves jobs from Ready as it is at each Serve, up to Children workers running them */
+	explicit ForkServer(Machine& Ready, u32 Children = 1);
+
+	/* Runs a job per line read from In on the workers, writing the results to Out until In ends.
+	*	@return false if forking is not supported or In or Out fail */
+	bool Serve(int In, int Out);
+
+	/* Listens on a Unix-domain socket at Path (replacing the file if any) and serves
+	*	each connection in turn, a job per line it sends. @return false on error, else never */
+	bool Listen(const char* Path);
+
+	/* Runs the job of Line on cpu and memory as they are, @return the result line, '\n' included */
+	static std::string Run(const std::string& Line, CPU& cpu, Mem& memory);
+
+private:
+	Machine& Ready;
+	const u32 Children;
+};
@@ -0,0 +1,182 @@
+#include <cstring>
+#include "main_6502.h"
+#include "opcode_info_6502.h"
+
+namespace
+{
+	using namespace m6502;
+
+	/* A round of a loop longer than this is not worth probing */
+	constexpr s32 MAX_ROUND_CYCLES = 256;
+
+	/* @return true if Opcode only changes registers and flags */
+	bool IsPure(Byte Opcode)
+	{
+		switch (Opcode)
+		{
+		case CPU::INS_STA_ZP: case CPU::INS_STA_ZPX: case CPU::INS_STA_ABS: case CPU::INS_STA_ABSX:
+		case CPU::INS_STA_ABSY: case CPU::INS_STA_INDX: case CPU::INS_STA_INDY:
+		case CPU::INS_STX_ZP: case CPU::INS_STX_ZPY: case CPU::INS_STX_ABS:
+		case CPU::INS_STY_ZP: case CPU::INS_STY_ZPX: case CPU::INS_STY_ABS:
+		case CPU::INS_INC_ZP: case CPU::INS_INC_ZPX: case CPU::INS_INC_ABS: case CPU::INS_INC_ABSX:
+		case CPU::INS_DEC_ZP: case CPU::INS_DEC_ZPX: case CPU::INS_DEC_ABS: case CPU::INS_DEC_ABSX:
+		case CPU::INS_PHA: case CPU::INS_PHP: case CPU::INS_PLA: case CPU::INS_PLP:
+		case CPU::INS_JSR: case CPU::INS_RTS:
+			return false;
+		default:
+			return OpcodeTable[Opcode].Handled;
+		}
+	}
+
+	/* @return true if the instruction at Address may read a device (see Mem::MapIo),
+	*	which can give something else on every round */
+	bool MayReadIo(Word Address, const Mem& memory)
+	{
+		const OpcodeInfo& Info = OpcodeTable[memory[Address]];
+		const Word Operand = memory[static_cast<Word>(Address + 1)] | (memory[static_cast<Word>(Address + 2)] << 8);
+		const u32 Page = Operand / Mem::PAGE_SIZE;
+		switch (Info.Mode)
+		{
+		case AddressingMode::Implied: case AddressingMode::Immediate: case AddressingMode::Relative:
+			return false;
+		case AddressingMode::ZeroPage: case AddressingMode::ZeroPageX: case AddressingMode::ZeroPageY:
+			return !memory.ReadPages[0];
+		case AddressingMode::Absolute:
+			return !memory.ReadPages[Page];
+		case AddressingMode::AbsoluteX: case AddressingMode::AbsoluteY:
+			return !memory.ReadPages[Page] || !memory.ReadPages[(Page + 1) % Mem::NUM_PAGES];
+		default:
+			// the address comes from memory, only safe without any device
+			for (u32 Any = 0; Any < Mem::NUM_PAGES; Any++)
+			{
+				if (!memory.ReadPages[Any])
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+
+	/* Decodes the loop from Loop.Start to the jump back at Loop.End in a straight line
+	*	and keeps its bytes; Loop.Pure stays false if the decoding does not land on End */
+	void DecodeLoop(IdleLoop& Loop, const Mem& memory)
+	{
+		Loop.Starts = 0;
+		Loop.Pure = true;
+		u32 Offset = 0;
+		while (Offset <= static_cast<u32>(Loop.End - Loop.Start))
+		{
+			const Byte Opcode = memory[Loop.Start + Offset];
+			Loop.Starts |= 1u << Offset;
+			Loop.Pure = Loop.Pure && IsPure(Opcode) && !MayReadIo(static_cast<Word>(Loop.Start + Offset), memory);
+			Offset += OpcodeTable[Opcode].Length;
+		}
+		Loop.Pure = Loop.Pure && ((Loop.Starts >> (Loop.End - Loop.Start)) & 1);
+		Loop.Bytes = Offset;
+		std::memcpy(Loop.Code, &memory.Data[Loop.Start], Loop.Bytes);
+	}
+
+	bool SameState(const IdleLoop& Loop, const CPU& cpu)
+	{
+		return Loop.A == cpu.A && Loop.X == cpu.X && Loop.Y == cpu.Y && Loop.SP == cpu.SP
+			&& std::memcmp(&Loop.Status, &cpu.Status, sizeof(HostFlags)) == 0;
+	}
+}
+
+void m6502::CPU::SkipIdleLoop(s32& Cycles, Mem& memory, Word JumpAddress)
+{
+	// the state is noted on one jump back and compared on the next one, every CHECK_EVERY jumps
+	const bool Compare = (Idle.Countdown == 0);
+	if (Compare)
+	{
+		Idle.Countdown = IdleLoop::CHECK_EVERY;
+	}
+
+	// nothing left to skip (this is also what stops the probe below, it runs with no budget),
+	// or the loop is not in RAM, the code below reads it from Data
+	const Word Start = PC;
+	if (Cycles <= 0 || JumpAddress - Start > static_cast<s32>(IdleLoop::MAX_BYTES) - 3
+		|| JumpAddress >= Mem::MAX_MEM - IdleLoop::MAX_BYTES
+		|| !memory.ReadsRam(Start) || !memory.ReadsRam(static_cast<Word>(JumpAddress + 2)))
+	{
+		return;
+	}
+
+	// DEX/DEY/INX/INY + BNE: the register tells how many rounds are left
+	const Byte Step = memory.Data[Start];
+	if (Compare && JumpAddress == Start + 1 && memory.Data[JumpAddress] == INS_BNE &&
+		(Step == INS_DEX || Step == INS_DEY || Step == INS_INX || Step == INS_INY))
+	{
+		Byte& Register = (Step == INS_DEX || Step == INS_INX) ? X : Y;
+		const bool Down = (Step == INS_DEX || Step == INS_DEY);
+		const s32 RoundsLeft = Down ? Register : 256 - Register;
+		const OpcodeInfo& Branch = OpcodeTable[INS_BNE];
+		const bool Cross = (Start & 0xFF00) != ((JumpAddress + 2) & 0xFF00);
+		const s32 RoundCycles = OpcodeTable[Step].Cycles + Branch.Cycles + Branch.BranchPenalty
+			+ (Cross ? Branch.PageCrossPenalty : 0);
+
+		// the last round falls through the branch, it is run normally
+		s32 Rounds = (Cycles - 1) / RoundCycles;
+		if (Rounds > RoundsLeft - 1)
+		{
+			Rounds = RoundsLeft - 1;
+		}
+		if (Rounds > 0)
+		{
+			Register = static_cast<Byte>(Down ? Register - Rounds : Register + Rounds);
+			LoadRegisterSetStatus(Register);
+			Cycles -= Rounds * RoundCycles;
+			IdleCyclesSkipped += static_cast<u64>(Rounds) * RoundCycles;
+		}
+		return;
+	}
+
+	// any other loop is idle when it comes back to the same state without writing memory
+	SyncFlags();
+	if (!Compare || Idle.Start != Start || Idle.End != JumpAddress || !SameState(Idle, *this))
+	{
+		if (Idle.Start != Start || Idle.End != JumpAddress)
+		{
+			Idle.Start = Start;
+			Idle.End = JumpAddress;
+			Idle.Bytes = 0;
+		}
+		Idle.A = A;
+		Idle.X = X;
+		Idle.Y = Y;
+		Idle.SP = SP;
+		Idle.Status = Status;
+		return;
+	}
+	if (Idle.Bytes == 0 || std::memcmp(Idle.Code, &memory.Data[Start], Idle.Bytes) != 0)
+	{
+		DecodeLoop(Idle, memory);
+	}
+	if (!Idle.Pure)
+	{
+		return;
+	}
+
+	// run one round on a copy to get its cycles and to check that it does come back
+	CPU Probe = *this;
+	s32 RoundCycles = 0;
+	do
+	{
+		const u32 Offset = static_cast<Word>(Probe.PC - Start);
+		if (Offset >= Idle.Bytes || !((Idle.Starts >> Offset) & 1) || RoundCycles > MAX_ROUND_CYCLES)
+		{
+			return;
+		}
+		RoundCycles += Probe.Interpret(1, memory);
+	} while (Probe.PC != Start);
+	Probe.SyncFlags();
+	if (!SameState(Idle, Probe))
+	{
+		return;
+	}
+
+	const s32 Rounds = (Cycles - 1) / RoundCycles;
+	Cycles -= Rounds * RoundCycles;
+	IdleCyclesSkipped += static_cast<u64>(Rounds) * RoundCycles;
+}
@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "jit_6502.h"
+#include "opcode_info_6502.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define M6502_JIT_X64 1
+#include <sys/mman.h>
+#else
+#define M6502_JIT_X64 0
+#endif
+
+namespace
+{
+	using namespace m6502;
+
+	/* Offset of one flag of CPU::Status */
+	constexpr std::size_t FLAG_C = offsetof(CPU, Status) + offsetof(HostFlags, C);
+	constexpr std::size_t FLAG_Z = offsetof(CPU, Status) + offsetof(HostFlags, Z);
+	constexpr std::size_t FLAG_I = offsetof(CPU, Status) + offsetof(HostFlags, I);
+	constexpr std::size_t FLAG_D = offsetof(CPU, Status) + offsetof(HostFlags, D);
+	constexpr std::size_t FLAG_V = offsetof(CPU, Status) + offsetof(HostFlags, V);
+	constexpr std::size_t FLAG_N = offsetof(CPU, Status) + offsetof(HostFlags, N);
+
+	/* x86-64 code for one block.
+	*	rdi = CPU*, rsi = Mem* (Data is at offset 0); al is scratch */
+	class Emitter
+	{
+	public:
+		std::vector<Byte> Bytes;
+
+		static Byte Reg(std::size_t Offset) { return static_cast<Byte>(Offset); }
+
+		void Emit(std::initializer_list<Byte> Code) { Bytes.insert(Bytes.end(), Code); }
+
+		void Emit32(u32 Value)
+		{
+			for (u32 i = 0; i < 4; i++) {
+				Bytes.push_back(static_cast<Byte>(Value >> (8 * i)));
+			}
+		}
+
+		/* disp32 of a byte of Mem::Data */
+		void EmitAddress(Word Address) { Emit32(static_cast<u32>(offsetof(Mem, Data)) + Address); }
+
+		void LoadRegister(std::size_t Offset) { Emit({ 0x8A, 0x47, Reg(Offset) }); }		// mov al, [rdi+Offset]
+		void StoreRegister(std::size_t Offset) { Emit({ 0x88, 0x47, Reg(Offset) }); }	// mov [rdi+Offset], al
+		void LoadImmediate(Byte Value) { Emit({ 0xB0, Value }); }						// mov al, imm8
+		void LoadMemory(Word Address) { Emit({ 0x8A, 0x86 }); EmitAddress(Address); }	// mov al, [rsi+Address]
+
+		/* mov [rsi+Address], al, then bump the version of the written page */
+		void StoreMemory(Word Address)
+		{
+			Emit({ 0x88, 0x86 });
+			EmitAddress(Address);
+			BumpPageVersion(Address);
+		}
+
+		/* inc/dec byte [rsi+Address], then load the result in al */
+		void IncrementMemory(Word Address, bool Decrement)
+		{
+			Emit({ 0xFE, static_cast<Byte>(Decrement ? 0x8E : 0x86) });
+			EmitAddress(Address);
+			BumpPageVersion(Address);
+			LoadMemory(Address);
+		}
+
+		/* Bumps the version of the written page and marks the byte dirty, like Mem::Write */
+		void BumpPageVersion(Word Address)
+		{
+			Emit({ 0xFF, 0x86 });	// inc dword [rsi+PageVersion[page]]
+			Emit32(static_cast<u32>(offsetof(Mem, PageVersion) + (Address / Mem::PAGE_SIZE) * sizeof(u32)));
+#if M6502_DIRTY_MAP
+			SetBit(offsetof(Mem, DirtyPages), Address / Mem::PAGE_SIZE);
+			SetBit(offsetof(Mem, DirtyBytes), Address);
+#endif
+		}
+
+		/* or byte [rsi+Bitmap+Bit/8], 1<<(Bit%8): bit Bit of a little endian u64 bitmap */
+		void SetBit(std::size_t Bitmap, u32 Bit)
+		{
+			Emit({ 0x80, 0x8E });
+			Emit32(static_cast<u32>(Bitmap + Bit / 8));
+			Emit({ static_cast<Byte>(1 << (Bit % 8)) });
+		}
+
+		/* ALU op on al with an immediate (Opcode is the "al, imm8" form) */
+		void AluImmediate(Byte Opcode, Byte Value) { Emit({ Opcode, Value }); }
+
+		/* ALU op on al with a memory operand (Opcode is the "r8, r/m8" form) */
+		void AluMemory(Byte Opcode, Word Address) { Emit({ Opcode, 0x86 }); EmitAddress(Address); }
+
+		/* Status.N and Status.Z from al */
+		void SetNZ()
+		{
+			Emit({ 0x84, 0xC0 });						// test al, al
+			Emit({ 0x0F, 0x94, 0x47, Reg(FLAG_Z) });	// sete [rdi+Z]
+			Emit({ 0x0F, 0x98, 0x47, Reg(FLAG_N) });	// sets [rdi+N]
+		}
+
+		/* Status.C = bit 7 of al clear (compare instructions), follows SetNZ */
+		void SetCompareCarry() { Emit({ 0x0F, 0x99, 0x47, Reg(FLAG_C) }); }	// setns [rdi+C]
+
+		/* mov byte [rdi+Flag], Value */
+		void SetFlag(std::size_t Flag, Byte Value) { Emit({ 0xC6, 0x47, Reg(Flag), Value }); }
+
+		static constexpr Byte EXIT_SIZE = 6 + 5 + 1;
+
+		/* mov word [rdi+PC], Address; mov eax, ExtraCycles; ret */
+		void Exit(Word Address, s32 ExtraCycles)
+		{
+			Emit({ 0x66, 0xC7, 0x47, Reg(offsetof(CPU, PC)),
+				static_cast<Byte>(Address), static_cast<Byte>(Address >> 8) });
+			Emit({ 0xB8 });
+			Emit32(static_cast<u32>(ExtraCycles));
+			Emit({ 0xC3 });
+		}
+
+		/* Leaves to Taken when Flag is set (or clear), else to NotTaken */
+		void Branch(std::size_t Flag, bool TakenIfSet, Word Taken, s32 TakenCycles, Word NotTaken)
+		{
+			Emit({ 0x80, 0x7F, Reg(Flag), 0x00 });	// cmp byte [rdi+Flag], 0
+			Emit({ static_cast<Byte>(TakenIfSet ? 0x74 : 0x75), EXIT_SIZE });	// jz/jnz over the taken exit
+			Exit(Taken, TakenCycles);
+			Exit(NotTaken, 0);
+		}
+	};
+
+	/* Register field a load/store/transfer opcode works on */
+	std::size_t RegisterOf(Byte Opcode)
+	{
+		switch (Opcode)
+		{
+		case CPU::INS_LDX_IM: case CPU::INS_LDX_ZP: case CPU::INS_LDX_ABS:
+		case CPU::INS_STX_ZP: case CPU::INS_STX_ABS:
+		case CPU::INS_CMX_IM: case CPU::INS_CMX_ZP: case CPU::INS_CMX_ABS:
+			return offsetof(CPU, X);
+		case CPU::INS_LDY_IM: case CPU::INS_LDY_ZP: case CPU::INS_LDY_ABS:
+		case CPU::INS_STY_ZP: case CPU::INS_STY_ABS:
+		case CPU::INS_CMY_IM: case CPU::INS_CMY_ZP: case CPU::INS_CMY_ABS:
+			return offsetof(CPU, Y);
+		default:
+			return offsetof(CPU, A);
+		}
+	}
+
+	/** Translates one instruction, its cycles come from OpcodeTable.
+	*	Memory operands are only translated where memory reads or writes its RAM
+	*	(see Mem::ReadsRam), ROM and I/O are left to the interpreter.
+	*	@return false if it is not supported (nothing is emitted then) */
+	bool EmitInstruction(Emitter& Out, const MicroOp& Op, Word PC, const Mem& memory, bool& EndsBlock)
+	{
+		const Word Address = Op.Operand;
+		const Byte Value = static_cast<Byte>(Op.Operand);
+		const Word Next = PC + Op.Length;
+		const bool SamePage = (Address / Mem::PAGE_SIZE) == (PC / Mem::PAGE_SIZE);
+		EndsBlock = false;
+
+		switch (Op.Opcode)
+		{
+		case CPU::INS_LDA_IM: case CPU::INS_LDX_IM: case CPU::INS_LDY_IM:
+			Out.LoadImmediate(Value);
+			Out.StoreRegister(RegisterOf(Op.Opcode));
+			Out.SetNZ();
+			return true;
+		case CPU::INS_LDA_ZP: case CPU::INS_LDX_ZP: case CPU::INS_LDY_ZP:
+		case CPU::INS_LDA_ABS: case CPU::INS_LDX_ABS: case CPU::INS_LDY_ABS:
+			if (!memory.ReadsRam(Address)) return false;
+			Out.LoadMemory(Address);
+			Out.StoreRegister(RegisterOf(Op.Opcode));
+			Out.SetNZ();
+			return true;
+		case CPU::INS_STA_ZP: case CPU::INS_STX_ZP: case CPU::INS_STY_ZP:
+		case CPU::INS_STA_ABS: case CPU::INS_STX_ABS: case CPU::INS_STY_ABS:
+			if (SamePage) return false;		// self-modifying, leave it to the interpreter
+			if (!memory.WritesRam(Address)) return false;
+			Out.LoadRegister(RegisterOf(Op.Opcode));
+			Out.StoreMemory(Address);
+			return true;
+		case CPU::INS_INC_ZP: case CPU::INS_INC_ABS:
+		case CPU::INS_DEC_ZP: case CPU::INS_DEC_ABS:
+			if (SamePage || !memory.IsRam(Address)) return false;
+			Out.IncrementMemory(Address, Op.Opcode == CPU::INS_DEC_ZP || Op.Opcode == CPU::INS_DEC_ABS);
+			Out.SetNZ();
+			return true;
+		case CPU::INS_TAX: Out.LoadRegister(offsetof(CPU, A)); Out.StoreRegister(offsetof(CPU, X)); Out.SetNZ(); return true;
+		case CPU::INS_TAY: Out.LoadRegister(offsetof(CPU, A)); Out.StoreRegister(offsetof(CPU, Y)); Out.SetNZ(); return true;
+		case CPU::INS_TXA: Out.LoadRegister(offsetof(CPU, X)); Out.StoreRegister(offsetof(CPU, A)); Out.SetNZ(); return true;
+		case CPU::INS_TYA: Out.LoadRegister(offsetof(CPU, Y)); Out.StoreRegister(offsetof(CPU, A)); Out.SetNZ(); return true;
+		case CPU::INS_TSX: Out.LoadRegister(offsetof(CPU, SP)); Out.StoreRegister(offsetof(CPU, X)); Out.SetNZ(); return true;
+		case CPU::INS_TXS: Out.LoadRegister(offsetof(CPU, X)); Out.StoreRegister(offsetof(CPU, SP)); Out.SetNZ(); return true;
+		case CPU::INS_INX: case CPU::INS_INY: case CPU::INS_DEX: case CPU::INS_DEY:
+		{
+			const std::size_t Register =
+				(Op.Opcode == CPU::INS_INX || Op.Opcode == CPU::INS_DEX) ? offsetof(CPU, X) : offsetof(CPU, Y);
+			Out.LoadRegister(Register);
+			Out.Emit({ 0xFE, static_cast<Byte>((Op.Opcode == CPU::INS_INX || Op.Opcode == CPU::INS_INY) ? 0xC0 : 0xC8) });
+			Out.StoreRegister(Register);
+			Out.SetNZ();
+			return true;
+		}
+		case CPU::INS_AND_IM: case CPU::INS_OR_IM: case CPU::INS_XOR_IM:
+			Out.LoadRegister(offsetof(CPU, A));
+			Out.AluImmediate(Op.Opcode == CPU::INS_AND_IM ? 0x24 : Op.Opcode == CPU::INS_OR_IM ? 0x0C : 0x34, Value);
+			Out.StoreRegister(offsetof(CPU, A));
+			Out.SetNZ();
+			return true;
+		case CPU::INS_AND_ZP: case CPU::INS_OR_ZP: case CPU::INS_XOR_ZP:
+		case CPU::INS_AND_ABS: case CPU::INS_OR_ABS: case CPU::INS_XOR_ABS:
+		{
+			const bool IsAnd = Op.Opcode == CPU::INS_AND_ZP || Op.Opcode == CPU::INS_AND_ABS;
+			const bool IsOr = Op.Opcode == CPU::INS_OR_ZP || Op.Opcode == CPU::INS_OR_ABS;
+			if (!memory.ReadsRam(Address)) return false;
+			Out.LoadRegister(offsetof(CPU, A));
+			Out.AluMemory(IsAnd ? 0x22 : IsOr ? 0x0A : 0x32, Address);
+			Out.StoreRegister(offsetof(CPU, A));
+			Out.SetNZ();
+			return true;
+		}
+		case CPU::INS_CMP_IM: case CPU::INS_CMX_IM: case CPU::INS_CMY_IM:
+			Out.LoadRegister(RegisterOf(Op.Opcode));
+			Out.AluImmediate(0x2C, Value);		// sub al, imm8
+			Out.SetNZ();
+			Out.SetCompareCarry();
+			return true;
+		case CPU::INS_CMP_ZP: case CPU::INS_CMX_ZP: case CPU::INS_CMY_ZP:
+		case CPU::INS_CMP_ABS: case CPU::INS_CMX_ABS: case CPU::INS_CMY_ABS:
+			if (!memory.ReadsRam(Address)) return false;
+			Out.LoadRegister(RegisterOf(Op.Opcode));
+			Out.AluMemory(0x2A, Address);		// sub al, [rsi+Address]
+			Out.SetNZ();
+			Out.SetCompareCarry();
+			return true;
+		case CPU::INS_CLC: Out.SetFlag(FLAG_C, 0); return true;
+		case CPU::INS_SEC: Out.SetFlag(FLAG_C, 1); return true;
+		case CPU::INS_CLI: Out.SetFlag(FLAG_I, 0); return true;
+		case CPU::INS_SEI: Out.SetFlag(FLAG_I, 1); return true;
+		case CPU::INS_CLD: Out.SetFlag(FLAG_D, 0); return true;
+		case CPU::INS_SED: Out.SetFlag(FLAG_D, 1); return true;
+		case CPU::INS_CLV: Out.SetFlag(FLAG_V, 0); return true;
+		case CPU::INS_NOP: return true;
+		case CPU::INS_JMP_ABS:
+			Out.Exit(Address, 0);
+			EndsBlock = true;
+			return true;
+		case CPU::INS_BEQ: case CPU::INS_BNE: case CPU::INS_BCS: case CPU::INS_BCC:
+		case CPU::INS_BVS: case CPU::INS_BVC: case CPU::INS_BMI: case CPU::INS_BPL:
+		{
+			const Word Target = Next + static_cast<sByte>(Value);
+			const OpcodeInfo& Info = OpcodeTable[Op.Opcode];
+			const s32 TakenCycles = Info.BranchPenalty + (((Target & 0xFF00) != (Next & 0xFF00)) ? Info.PageCrossPenalty : 0);
+			std::size_t Flag = FLAG_Z;
+			switch (Op.Opcode)
+			{
+			case CPU::INS_BCS: case CPU::INS_BCC: Flag = FLAG_C; break;
+			case CPU::INS_BVS: case CPU::INS_BVC: Flag = FLAG_V; break;
+			case CPU::INS_BMI: case CPU::INS_BPL: Flag = FLAG_N; break;
+			default: break;
+			}
+			const bool TakenIfSet = Op.Opcode == CPU::INS_BEQ || Op.Opcode == CPU::INS_BCS ||
+				Op.Opcode == CPU::INS_BVS || Op.Opcode == CPU::INS_BMI;
+			Out.Branch(Flag, TakenIfSet, Target, TakenCycles, Next);
+			EndsBlock = true;
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+}
+
+bool m6502::Jit::Available()
+{
+	return M6502_JIT_X64 != 0;
+}
+
+m6502::Jit::Jit()
+	: PageMapVersion(Mem::NUM_PAGES, 0), Inlined(Mem::NUM_PAGES, false), BlockAt(Mem::MAX_MEM, NO_BLOCK), Heat(Mem::MAX_MEM, 0)
+{
+#if M6502_JIT_X64
+	void* Memory = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	Code = (Memory == MAP_FAILED) ? nullptr : static_cast<Byte*>(Memory);
+#endif
+}
+
+m6502::Jit::~Jit()
+{
+#if M6502_JIT_X64
+	if (Code)
+	{
+		munmap(Code, CODE_SIZE);
+	}
+#endif
+}
+
+void m6502::Jit::Flush()
+{
+	std::fill(Inlined.begin(), Inlined.end(), false);
+	Blocks.clear();
+	std::fill(BlockAt.begin(), BlockAt.end(), NO_BLOCK);
+	std::fill(Heat.begin(), Heat.end(), 0);
+	CodeUsed = 0;
+}
+
+bool m6502::Jit::NoteMap(const Mem& memory)
+{
+	bool Remapped = false;
+	for (u32 Page = 0; Page < Mem::NUM_PAGES; Page++)
+	{
+		if (PageMapVersion[Page] != memory.PageMapVersion[Page])
+		{
+			Remapped = Remapped || Inlined[Page];
+			PageMapVersion[Page] = memory.PageMapVersion[Page];
+		}
+	}
+	MapVersion = memory.MapVersion;
+	return Remapped;
+}
+
+const m6502::Jit::CompiledBlock* m6502::Jit::Find(Word Address, const Mem& memory)
+{
+	if (memory.Id != MemId)
+	{
+		Flush();
+		MemId = memory.Id;
+		NoteMap(memory);
+	}
+	else if (memory.MapVersion != MapVersion && NoteMap(memory))
+	{
+		Flush();
+	}
+	const Word Index = BlockAt[Address];
+	if (Index == NO_BLOCK)
+	{
+		return nullptr;
+	}
+	const CompiledBlock& Block = Blocks[Index];
+	if (Block.Version != memory.PageVersion[Address / Mem::PAGE_SIZE])
+	{
+		// the page was written since, profile it again
+		BlockAt[Address] = NO_BLOCK;
+		Heat[Address] = 0;
+		return nullptr;
+	}
+	return &Block;
+}
+
+void m6502::Jit::Profile(Word Address, const Mem& memory)
+{
+	if (!Code || ++Heat[Address] < HOT_THRESHOLD)
+	{
+		return;
+	}
+	Heat[Address] = 0;
+	if (!Compile(Address, memory))
+	{
+		// remember the failure until the page changes
+		CompiledBlock Failed = { nullptr, memory.PageVersion[Address / Mem::PAGE_SIZE], 0, 0, -1 };
+		if (Blocks.size() < NO_BLOCK)
+		{
+			BlockAt[Address] = static_cast<Word>(Blocks.size());
+			Blocks.push_back(Failed);
+		}
+	}
+}
+
+bool m6502::Jit::Compile(Word Address, const Mem& memory)
+{
+#if M6502_JIT_X64
+	const u32 Page = Address / Mem::PAGE_SIZE;
+	Emitter Out;
+	s32 Cycles = 0;
+	s32 LastCycles = 0;
+	bool Ended = false;
+	s32 JumpBack = -1;
+	u32 PC = Address;
+	std::vector<u32> InlinedPages;
+	for (u32 i = 0; i < MAX_BLOCK_OPS && !Ended && PC / Mem::PAGE_SIZE == Page; i++)
+	{
+		MicroOp Op = CPU::Decode(static_cast<Word>(PC), memory);
+		if (!Op.Handler || (PC + Op.Length - 1) / Mem::PAGE_SIZE != Page)
+		{
+			break;
+		}
+		if (!EmitInstruction(Out, Op, static_cast<Word>(PC), memory, Ended))
+		{
+			break;
+		}
+		const AddressingMode Mode = OpcodeTable[Op.Opcode].Mode;
+		if ((Mode == AddressingMode::ZeroPage || Mode == AddressingMode::Absolute) && Op.Opcode != CPU::INS_JMP_ABS)
+		{
+			InlinedPages.push_back(Op.Operand / Mem::PAGE_SIZE);
+		}
+		if (Ended)
+		{
+			// a loop the interpreter would look at for idling (see CPU::SkipIdleLoop)
+			const u32 Target = (Op.Opcode == CPU::INS_JMP_ABS) ? Op.Operand
+				: static_cast<Word>(PC + Op.Length + static_cast<sByte>(Op.Operand));
+			JumpBack = (Target <= PC) ? static_cast<s32>(PC) : -1;
+		}
+		Cycles += Op.Cycles;
+		LastCycles = Op.Cycles;
+		PC += Op.Length;
+	}
+	if (Cycles == 0)
+	{
+		return false;
+	}
+	if (!Ended)
+	{
+		Out.Exit(static_cast<Word>(PC), 0);
+	}
+
+	if (CodeUsed + Out.Bytes.size() > CODE_SIZE || Blocks.size() >= NO_BLOCK)
+	{
+		Flush();
+	}
+	if (mprotect(Code, CODE_SIZE, PROT_READ | PROT_WRITE) != 0)
+	{
+		return false;
+	}
+	Byte* Entry = Code + CodeUsed;
+	std::memcpy(Entry, Out.Bytes.data(), Out.Bytes.size());
+	CodeUsed += static_cast<u32>((Out.Bytes.size() + 15) & ~static_cast<std::size_t>(15));
+	mprotect(Code, CODE_SIZE, PROT_READ | PROT_EXEC);
+
+	// only now, a Flush above would have forgotten them
+	for (u32 Inlines : InlinedPages)
+	{
+		Inlined[Inlines] = true;
+	}
+	CompiledBlock Block = { reinterpret_cast<BlockFn>(Entry), memory.PageVersion[Page], Cycles, LastCycles, JumpBack };
+	BlockAt[Address] = static_cast<Word>(Blocks.size());
+	Blocks.push_back(Block);
+	return true;
+#else
+	(void)Address;
+	(void)memory;
+	return false;
+#endif
+}
+
+/* @return the number of cycles that were used */
+m6502::s32 m6502::CPU::Execute(s32 Cycles, Mem& memory, Jit& jit)
+{
+	const u32 CycleRequested = Cycles;
+	UnpackStatus();
+	while (Cycles > 0)
+	{
+		const Jit::CompiledBlock* Block = jit.Find(PC, memory);
+		// the interpreter would run the last instruction only if the budget lasts until then
+		if (Block && Block->Code && Cycles > Block->Cycles - Block->LastCycles)
+		{
+			SyncFlags();		// native code reads and writes Status directly
+			Cycles -= Block->Cycles;
+			Cycles -= Block->Code(this, &memory);
+#if M6502_IDLE_SKIP
+			// the jump back was taken, same as the JMP and branch handlers do
+			if (Block->JumpBack >= 0 && PC <= Block->JumpBack && --Idle.Countdown <= 1)
+			{
+				SkipIdleLoop(Cycles, memory, static_cast<Word>(Block->JumpBack));
+			}
+#endif
+			continue;
+		}
+		if (!Block)
+		{
+			jit.Profile(PC, memory);
+		}
+		Cycles -= Interpret(1, memory);
+	}
+	PackStatus();
+	const s32 NumCyclesUsed = CycleRequested - Cycles;
+	return NumCyclesUsed;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include "main_6502.h"
+
+/** Dynamic recompiler for hot 6502 code (x86-64 Linux only).
+*	Straight-line runs that start at an address executed HOT_THRESHOLD times
+*	are translated into native code. Anything the translator does not know,
+*	and all cold code, runs in the interpreter (CPU::Execute).
+*	A compiled block stays inside one page and is dropped when that page is
+*	written (see Mem::PageVersion). Only memory accesses to RAM are compiled,
+*	every block is dropped when a page one of them accesses is remapped. */
+struct m6502::Jit
+{
+	static constexpr u32 HOT_THRESHOLD = 8;
+	static constexpr u32 MAX_BLOCK_OPS = 32;
+	static constexpr u32 CODE_SIZE = 1024 * 1024;
+
+	Jit();
+	~Jit();
+	Jit(const Jit&) = delete;
+	Jit& operator=(const Jit&) = delete;
+
+	/* @return true if this build can generate native code */
+	static bool Available();
+
+	/* Drops every compiled block */
+	void Flush();
+
+	/* @return the number of blocks compiled since the last flush */
+	u32 CompiledBlocks() const { return static_cast<u32>(Blocks.size()); }
+
+private:
+	friend struct CPU;
+
+	/* Native block: updates cpu and memory, sets PC and returns the extra cycles of a taken branch */
+	using BlockFn = s32 (*)(CPU* cpu, Mem* memory);
+
+	struct CompiledBlock
+	{
+		BlockFn Code;
+		u32 Version;		// Mem::PageVersion of the block's page when it was compiled
+		s32 Cycles;			// base cycles of the whole block
+		s32 LastCycles;		// base cycles of its last instruction
+		s32 JumpBack;		// address of its last instruction if that jumps back (JMP or branch), else -1
+	};
+
+	static constexpr Word NO_BLOCK = 0xFFFF;
+
+	/* @return the block compiled at Address for memory (Code is nullptr if it could not be compiled), or nullptr */
+	const CompiledBlock* Find(Word Address, const Mem& memory);
+
+	/* Counts one interpreted execution of Address and compiles it once it is hot */
+	void Profile(Word Address, const Mem& memory);
+
+	bool Compile(Word Address, const Mem& memory);
+
+	/* Notes the page table of memory, @return true if a page compiled code accesses was remapped since */
+	bool NoteMap(const Mem& memory);
+
+	u32 MemId = 0;
+	u32 MapVersion = 0;			// Mem::MapVersion when the page table was last noted
+	std::vector<u32> PageMapVersion;	// Mem::PageMapVersion per page, idem
+	std::vector<bool> Inlined;		// per page, compiled code reads or writes it directly
+	Byte* Code = nullptr;
+	u32 CodeUsed = 0;
+	std::vector<CompiledBlock> Blocks;
+	std::vector<Word> BlockAt;		// index into Blocks per address, or NO_BLOCK
+	std::vector<Byte> Heat;			// interpreted executions per address
+};
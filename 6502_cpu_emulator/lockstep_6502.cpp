@@ -0,0 +1,711 @@
+#include <cstring>
+#include <initializer_list>
+#include "lockstep_6502.h"
+#include "opcodes_6502.h"
+
+/* The vector form of the registers: AVX2 when the build targets it (-mavx2, /arch:AVX2),
+*	SSE2 on any other x86-64, plain loops over the lanes elsewhere */
+#if defined(__AVX2__)
+#define M6502_LOCKSTEP_AVX2 1
+#define M6502_LOCKSTEP_SSE2 0
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define M6502_LOCKSTEP_AVX2 0
+#define M6502_LOCKSTEP_SSE2 1
+#include <emmintrin.h>
+#else
+#define M6502_LOCKSTEP_AVX2 0
+#define M6502_LOCKSTEP_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	using namespace m6502;
+
+	constexpr u32 LANES = Lockstep::MAX_LANES;
+
+	/* @return the lowest lane of Bits, which is not 0 */
+	inline u32 LowestLane(u32 Bits)
+	{
+#if defined(_MSC_VER)
+		unsigned long Index;
+		_BitScanForward(&Index, Bits);
+		return Index;
+#else
+		return static_cast<u32>(__builtin_ctz(Bits));
+#endif
+	}
+
+#if M6502_LOCKSTEP_AVX2
+	/* A byte per lane */
+	struct Vec
+	{
+		__m256i V;
+	};
+
+	inline Vec Load(const Byte* From) { return { _mm256_load_si256(reinterpret_cast<const __m256i*>(From)) }; }
+	inline void Store(Byte* To, Vec Value) { _mm256_store_si256(reinterpret_cast<__m256i*>(To), Value.V); }
+	inline Vec Splat(Byte Value) { return { _mm256_set1_epi8(static_cast<char>(Value)) }; }
+	inline Vec operator+(Vec L, Vec R) { return { _mm256_add_epi8(L.V, R.V) }; }
+	inline Vec operator-(Vec L, Vec R) { return { _mm256_sub_epi8(L.V, R.V) }; }
+	inline Vec operator&(Vec L, Vec R) { return { _mm256_and_si256(L.V, R.V) }; }
+	inline Vec operator|(Vec L, Vec R) { return { _mm256_or_si256(L.V, R.V) }; }
+	inline Vec operator^(Vec L, Vec R) { return { _mm256_xor_si256(L.V, R.V) }; }
+
+	/* 0xFF in the lanes where L == R, 0 in the others */
+	inline Vec Equal(Vec L, Vec R) { return { _mm256_cmpeq_epi8(L.V, R.V) }; }
+
+	/* IfSet in the lanes where Mask is 0xFF, Else in the others */
+	inline Vec Select(Vec Mask, Vec IfSet, Vec Else) { return { _mm256_blendv_epi8(Else.V, IfSet.V, Mask.V) }; }
+
+	/* bit Bit of every lane, 0 or 1 */
+	template <int Bit>
+	inline Vec BitOf(Vec Value) { return { _mm256_and_si256(_mm256_srli_epi16(Value.V, Bit), _mm256_set1_epi8(1)) }; }
+
+	/* a bit per lane, set where Mask is 0xFF */
+	inline u32 Bits(Vec Mask) { return static_cast<u32>(_mm256_movemask_epi8(Mask.V)); }
+
+	/* 0xFF in the lanes of Group, 0 in the others */
+	inline Vec LaneMask(u32 Group)
+	{
+		// byte i gets byte i / 8 of Group, then its bit i % 8
+		const __m256i Spread = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(Group)),
+			_mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+				2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3));
+		const __m256i Bit = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ull));
+		return { _mm256_cmpeq_epi8(_mm256_and_si256(Spread, Bit), Bit) };
+	}
+#elif M6502_LOCKSTEP_SSE2
+	/* A byte per lane, lanes 0-15 in Lo */
+	struct Vec
+	{
+		__m128i Lo, Hi;
+	};
+
+	inline Vec Load(const Byte* From)
+	{
+		return { _mm_load_si128(reinterpret_cast<const __m128i*>(From)), _mm_load_si128(reinterpret_cast<const __m128i*>(From + 16)) };
+	}
+	inline void Store(Byte* To, Vec Value)
+	{
+		_mm_store_si128(reinterpret_cast<__m128i*>(To), Value.Lo);
+		_mm_store_si128(reinterpret_cast<__m128i*>(To + 16), Value.Hi);
+	}
+	inline Vec Splat(Byte Value) { const __m128i V = _mm_set1_epi8(static_cast<char>(Value)); return { V, V }; }
+	inline Vec operator+(Vec L, Vec R) { return { _mm_add_epi8(L.Lo, R.Lo), _mm_add_epi8(L.Hi, R.Hi) }; }
+	inline Vec operator-(Vec L, Vec R) { return { _mm_sub_epi8(L.Lo, R.Lo), _mm_sub_epi8(L.Hi, R.Hi) }; }
+	inline Vec operator&(Vec L, Vec R) { return { _mm_and_si128(L.Lo, R.Lo), _mm_and_si128(L.Hi, R.Hi) }; }
+	inline Vec operator|(Vec L, Vec R) { return { _mm_or_si128(L.Lo, R.Lo), _mm_or_si128(L.Hi, R.Hi) }; }
+	inline Vec operator^(Vec L, Vec R) { return { _mm_xor_si128(L.Lo, R.Lo), _mm_xor_si128(L.Hi, R.Hi) }; }
+
+	/* 0xFF in the lanes where L == R, 0 in the others */
+	inline Vec Equal(Vec L, Vec R) { return { _mm_cmpeq_epi8(L.Lo, R.Lo), _mm_cmpeq_epi8(L.Hi, R.Hi) }; }
+
+	/* IfSet in the lanes where Mask is 0xFF, Else in the others */
+	inline Vec Select(Vec Mask, Vec IfSet, Vec Else)
+	{
+		return { _mm_or_si128(_mm_and_si128(Mask.Lo, IfSet.Lo), _mm_andnot_si128(Mask.Lo, Else.Lo)),
+			_mm_or_si128(_mm_and_si128(Mask.Hi, IfSet.Hi), _mm_andnot_si128(Mask.Hi, Else.Hi)) };
+	}
+
+	/* bit Bit of every lane, 0 or 1 */
+	template <int Bit>
+	inline Vec BitOf(Vec Value)
+	{
+		const __m128i One = _mm_set1_epi8(1);
+		return { _mm_and_si128(_mm_srli_epi16(Value.Lo, Bit), One), _mm_and_si128(_mm_srli_epi16(Value.Hi, Bit), One) };
+	}
+
+	/* a bit per lane, set where Mask is 0xFF */
+	inline u32 Bits(Vec Mask)
+	{
+		return static_cast<u32>(_mm_movemask_epi8(Mask.Lo)) | (static_cast<u32>(_mm_movemask_epi8(Mask.Hi)) << 16);
+	}
+
+	/* 0xFF in the lanes of Group, 0 in the others */
+	inline Vec LaneMask(u32 Group)
+	{
+		// each byte of Group spread over 8 lanes, then each lane keeps its own bit
+		auto Spread = [](u32 Bits16)
+		{
+			return _mm_set_epi64x(static_cast<long long>(((Bits16 >> 8) & 0xFF) * 0x0101010101010101ull),
+				static_cast<long long>((Bits16 & 0xFF) * 0x0101010101010101ull));
+		};
+		const __m128i Bit = _mm_set1_epi64x(static_cast<long long>(0x8040201008040201ull));
+		return { _mm_cmpeq_epi8(_mm_and_si128(Spread(Group), Bit), Bit),
+			_mm_cmpeq_epi8(_mm_and_si128(Spread(Group >> 16), Bit), Bit) };
+	}
+#else
+	/* A byte per lane */
+	struct Vec
+	{
+		Byte V[LANES];
+	};
+
+	template <typename Operation>
+	inline Vec Map(Vec L, Vec R, Operation Op)
+	{
+		Vec Out;
+		for (u32 Lane = 0; Lane < LANES; Lane++)
+		{
+			Out.V[Lane] = static_cast<Byte>(Op(L.V[Lane], R.V[Lane]));
+		}
+		return Out;
+	}
+
+	inline Vec Load(const Byte* From) { Vec Out; for (u32 Lane = 0; Lane < LANES; Lane++) Out.V[Lane] = From[Lane]; return Out; }
+	inline void Store(Byte* To, Vec Value) { for (u32 Lane = 0; Lane < LANES; Lane++) To[Lane] = Value.V[Lane]; }
+	inline Vec Splat(Byte Value) { Vec Out; for (u32 Lane = 0; Lane < LANES; Lane++) Out.V[Lane] = Value; return Out; }
+	inline Vec operator+(Vec L, Vec R) { return Map(L, R, [](Byte l, Byte r) { return l + r; }); }
+	inline Vec operator-(Vec L, Vec R) { return Map(L, R, [](Byte l, Byte r) { return l - r; }); }
+	inline Vec operator&(Vec L, Vec R) { return Map(L, R, [](Byte l, Byte r) { return l & r; }); }
+	inline Vec operator|(Vec L, Vec R) { return Map(L, R, [](Byte l, Byte r) { return l | r; }); }
+	inline Vec operator^(Vec L, Vec R) { return Map(L, R, [](Byte l, Byte r) { return l ^ r; }); }
+
+	/* 0xFF in the lanes where L == R, 0 in the others */
+	inline Vec Equal(Vec L, Vec R) { return Map(L, R, [](Byte l, Byte r) { return l == r ? 0xFF : 0x00; }); }
+
+	/* IfSet in the lanes where Mask is 0xFF, Else in the others */
+	inline Vec Select(Vec Mask, Vec IfSet, Vec Else) { return (Mask & IfSet) | Map(Mask, Else, [](Byte m, Byte e) { return ~m & e; }); }
+
+	/* bit Bit of every lane, 0 or 1 */
+	template <int Bit>
+	inline Vec BitOf(Vec Value) { return Map(Value, Value, [](Byte v, Byte) { return (v >> Bit) & 1; }); }
+
+	/* a bit per lane, set where Mask is 0xFF */
+	inline u32 Bits(Vec Mask)
+	{
+		u32 Out = 0;
+		for (u32 Lane = 0; Lane < LANES; Lane++)
+		{
+			Out |= static_cast<u32>(Mask.V[Lane] >> 7) << Lane;
+		}
+		return Out;
+	}
+
+	/* 0xFF in the lanes of Group, 0 in the others */
+	inline Vec LaneMask(u32 Group)
+	{
+		Vec Out;
+		for (u32 Lane = 0; Lane < LANES; Lane++)
+		{
+			Out.V[Lane] = ((Group >> Lane) & 1) ? 0xFF : 0x00;
+		}
+		return Out;
+	}
+#endif
+
+	inline Vec IsZero(Vec Value) { return Equal(Value, Splat(0)) & Splat(1); }
+
+	/* Sets Register to Value in the lanes of Mask */
+	inline void Assign(Byte* Register, Vec Value, Vec Mask)
+	{
+		Store(Register, Select(Mask, Value, Load(Register)));
+	}
+
+	/* @return true if the instruction at Pc in memory is Bytes, read straight from RAM or ROM */
+	inline bool SameInstruction(const Mem& memory, Word Pc, const Byte* Bytes, u32 Length)
+	{
+		for (u32 i = 0; i < Length; i++)
+		{
+			const Word Address = static_cast<Word>(Pc + i);
+			const Byte* Host = memory.ReadPages[Address / Mem::PAGE_SIZE];
+			if (!Host || Host[Address % Mem::PAGE_SIZE] != Bytes[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/* @return true if the instruction at Pc can be read without touching a device */
+	inline bool InHostMemory(const Mem& memory, Word Pc)
+	{
+		return memory.ReadPages[Pc / Mem::PAGE_SIZE] && memory.ReadPages[static_cast<Word>(Pc + 2) / Mem::PAGE_SIZE];
+	}
+
+	/* @return true if Opcode runs for a group at once: its addressing mode has no indirection */
+	bool HasGroupForm(Byte Opcode)
+	{
+		switch (OpcodeTable[Opcode].Mode)
+		{
+		case AddressingMode::Indirect: case AddressingMode::IndirectX: case AddressingMode::IndirectY:
+			return false;
+		default:
+			break;
+		}
+		return OpcodeTable[Opcode].Handled;
+	}
+
+	/* Opcodes whose mnemonic is one of Mnemonics */
+	struct MnemonicSet
+	{
+		bool Has[256] = {};
+
+		MnemonicSet(std::initializer_list<const char*> Mnemonics)
+		{
+			for (u32 Opcode = 0; Opcode < 256; Opcode++)
+			{
+				for (const char* Mnemonic : Mnemonics)
+				{
+					Has[Opcode] = Has[Opcode] || std::strcmp(OpcodeTable[static_cast<Byte>(Opcode)].Mnemonic, Mnemonic) == 0;
+				}
+			}
+		}
+	};
+
+	/* @return true if Opcode may write to memory */
+	bool WritesMemory(Byte Opcode)
+	{
+		static const MnemonicSet Writing = { "STA", "STX", "STY", "INC", "DEC", "PHA", "PHP", "JSR" };
+		return Writing.Has[Opcode];
+	}
+
+	/* @return true if Opcode only writes the two bytes under SP (see CPU::PushPCToStack) */
+	bool WritesStack(Byte Opcode)
+	{
+		static const MnemonicSet Pushing = { "PHA", "PHP", "JSR" };
+		return Pushing.Has[Opcode];
+	}
+
+	/* The handlers of the interpreter by opcode, like its dispatch table */
+	struct HandlerTable
+	{
+		OpHandler Handlers[256];
+	};
+
+	constexpr HandlerTable MakeHandlerTable()
+	{
+		HandlerTable Table{};
+		for (u32 i = 0; i < 256; i++)
+		{
+			Table.Handlers[i] = Ops::Op_NotHandled;
+		}
+#define M6502_BIND_OPCODE(Name, Mnemonic, Mode, Length, Cycles, PageCross, Branch) \
+		Table.Handlers[CPU::INS_##Name] = Ops::Op_##Name;
+		M6502_HANDLED_OPCODES(M6502_BIND_OPCODE)
+#undef M6502_BIND_OPCODE
+		return Table;
+	}
+
+	constexpr HandlerTable Handlers = MakeHandlerTable();
+}
+
+m6502::u32 m6502::Lockstep::AddLane(const CPU& cpu, Mem& memory)
+{
+	if (Lanes == MAX_LANES)
+	{
+		return MAX_LANES;
+	}
+	const u32 Lane = Lanes++;
+	Scratch = cpu;
+	Scratch.UnpackStatus();
+	SaveLane(Lane, Scratch);
+	Memories[Lane] = &memory;
+	return Lane;
+}
+
+void m6502::Lockstep::GetLane(u32 Lane, CPU& cpu) const
+{
+	LoadLane(Lane, cpu);
+	cpu.PackStatus();
+}
+
+void m6502::Lockstep::LoadLane(u32 Lane, CPU& cpu) const
+{
+	cpu.PC = PC[Lane];
+	cpu.SP = SP[Lane];
+	cpu.A = A[Lane];
+	cpu.X = X[Lane];
+	cpu.Y = Y[Lane];
+	cpu.Status.C = C[Lane];
+	cpu.Status.Z = Z[Lane];
+	cpu.Status.I = I[Lane];
+	cpu.Status.D = D[Lane];
+	cpu.Status.B = B[Lane];
+	cpu.Status.Unused = Unused[Lane];
+	cpu.Status.V = V[Lane];
+	cpu.Status.N = N[Lane];
+	cpu.FlagKind = CPU::FLAGS_SYNCED;
+}
+
+void m6502::Lockstep::SaveLane(u32 Lane, CPU& cpu)
+{
+	cpu.SyncFlags();
+	PC[Lane] = cpu.PC;
+	SP[Lane] = cpu.SP;
+	A[Lane] = cpu.A;
+	X[Lane] = cpu.X;
+	Y[Lane] = cpu.Y;
+	C[Lane] = cpu.Status.C;
+	Z[Lane] = cpu.Status.Z;
+	I[Lane] = cpu.Status.I;
+	D[Lane] = cpu.Status.D;
+	B[Lane] = cpu.Status.B;
+	Unused[Lane] = cpu.Status.Unused;
+	V[Lane] = cpu.Status.V;
+	N[Lane] = cpu.Status.N;
+}
+
+m6502::u32 m6502::Lockstep::SameCodeAs(u32 Lead, u32 Page)
+{
+	if (CodeGeneration[Page] != Generation || !((SameCode[Page] >> Lead) & 1))
+	{
+		const Byte* LeadCode = Memories[Lead]->ReadPages[Page];
+		u32 Same = 0;
+		for (u32 Lane = 0; Lane < Lanes; Lane++)
+		{
+			const Byte* Code = Memories[Lane]->ReadPages[Page];
+			const bool Equal = Code && (Code == LeadCode || std::memcmp(Code, LeadCode, Mem::PAGE_SIZE) == 0);
+			Same |= static_cast<u32>(Equal) << Lane;
+		}
+		SameCode[Page] = Same;
+		CodeGeneration[Page] = Generation;
+	}
+	return SameCode[Page];
+}
+
+void m6502::Lockstep::Written(u32 Lane, Word Address)
+{
+	const u32 Page = Address / Mem::PAGE_SIZE;
+	CodeGeneration[Page] = 0;
+	if (!Memories[Lane]->WritesRam(Address))
+	{
+		// a device may have mapped other memory in
+		Generation++;
+	}
+}
+
+void m6502::Lockstep::Execute(s32 Cycles)
+{
+	Generation++;		// memory may have changed since the last time
+
+	u32 Active = 0;
+	bool Together = true;		// every active lane is at the same PC
+	for (u32 Lane = 0; Lane < Lanes; Lane++)
+	{
+		Remaining[Lane] = Cycles;
+		Active |= (Cycles > 0 ? 1u : 0u) << Lane;
+		Together = Together && PC[Lane] == PC[0];
+	}
+
+	while (Active)
+	{
+		// the lowest PC first: the lanes a forward branch left behind catch up with the others
+		u32 Lead = LowestLane(Active);
+		if (!Together)
+		{
+			for (u32 Others = Active & (Active - 1); Others; Others &= Others - 1)
+			{
+				const u32 Lane = LowestLane(Others);
+				Lead = (PC[Lane] < PC[Lead]) ? Lane : Lead;
+			}
+		}
+		const Word Pc = PC[Lead];
+		const Mem& LeadMemory = *Memories[Lead];
+		if (!InHostMemory(LeadMemory, Pc))
+		{
+			// a device may answer each read differently, only the lane itself reads it
+			StepLane(Lead);
+			LaneSteps++;
+			Active &= (Remaining[Lead] > 0) ? ~0u : ~(1u << Lead);
+			Together = false;
+			continue;
+		}
+
+		const Byte Opcode = LeadMemory.Read(Pc);
+		const u32 Length = OpcodeTable[Opcode].Length;
+		const Byte Bytes[3] = { Opcode, LeadMemory.Read(static_cast<Word>(Pc + 1)), LeadMemory.Read(static_cast<Word>(Pc + 2)) };
+		u32 Group = Active;
+		if (!Together)
+		{
+			Group = 0;
+			for (u32 Candidates = Active; Candidates; Candidates &= Candidates - 1)
+			{
+				const u32 Lane = LowestLane(Candidates);
+				Group |= static_cast<u32>(PC[Lane] == Pc) << Lane;
+			}
+		}
+		// lanes with the same code page run the same instruction, the others are compared byte by byte
+		const u32 Page = Pc / Mem::PAGE_SIZE;
+		const u32 Same = (Page == static_cast<Word>(Pc + Length - 1) / Mem::PAGE_SIZE) ? SameCodeAs(Lead, Page) : 1u << Lead;
+		for (u32 Candidates = Group & ~Same; Candidates; Candidates &= Candidates - 1)
+		{
+			const u32 Lane = LowestLane(Candidates);
+			Group &= SameInstruction(*Memories[Lane], Pc, Bytes, Length) ? ~0u : ~(1u << Lane);
+		}
+
+		Together = (Group == Active);
+		if (HasGroupForm(Opcode) && (Group & (Group - 1)))
+		{
+			const Word Operand = (Length == 3) ? static_cast<Word>(Bytes[1] | (Bytes[2] << 8)) : Bytes[1];
+			Together = StepGroup(Group, Opcode, Operand) && Together;
+			GroupSteps++;
+		}
+		else
+		{
+			for (u32 Lanes = Group; Lanes; Lanes &= Lanes - 1)
+			{
+				StepLane(LowestLane(Lanes));
+				LaneSteps++;
+			}
+			Together = Together && !(Group & (Group - 1));
+		}
+
+		u32 Finished = 0;
+		for (u32 Lane = 0; Lane < MAX_LANES; Lane++)
+		{
+			Finished |= static_cast<u32>(Remaining[Lane] <= 0) << Lane;
+		}
+		Active &= ~Finished;
+	}
+
+	for (u32 Lane = 0; Lane < Lanes; Lane++)
+	{
+		Used[Lane] = Cycles - Remaining[Lane];
+	}
+}
+
+void m6502::Lockstep::StepLane(u32 Lane)
+{
+	LoadLane(Lane, Scratch);
+	if (WritesMemory(Memories[Lane]->Read(Scratch.PC)))
+	{
+		Generation++;
+	}
+	Remaining[Lane] -= Scratch.Interpret(1, *Memories[Lane]);
+	SaveLane(Lane, Scratch);
+}
+
+bool m6502::Lockstep::StepHandler(u32 Group, Byte Opcode, Word Operand)
+{
+	const OpHandler Handler = Handlers.Handlers[Opcode];
+	const bool Stack = WritesStack(Opcode);
+	const bool Writes = WritesMemory(Opcode);
+	bool Together = true;
+	for (u32 Lanes = Group; Lanes; Lanes &= Lanes - 1)
+	{
+		const u32 Lane = LowestLane(Lanes);
+		LoadLane(Lane, Scratch);
+		const Word Top = Scratch.SPToAddress();
+		Handler(Scratch, Remaining[Lane], *Memories[Lane], Operand);
+		SaveLane(Lane, Scratch);
+		if (Stack)
+		{
+			Written(Lane, Top);
+			Written(Lane, static_cast<Word>(Top - 1));
+		}
+		else if (Writes)
+		{
+			Generation++;
+		}
+		// each lane goes where its own state says (RTS), they may part here
+		Together = Together && PC[Lane] == PC[LowestLane(Group)];
+	}
+	return Together;
+}
+
+m6502::Word m6502::Lockstep::OperandAddress(u32 Lane, Byte Opcode, Word Operand) const
+{
+	switch (OpcodeTable[Opcode].Mode)
+	{
+	case AddressingMode::ZeroPageX: return static_cast<Byte>(Operand + X[Lane]);
+	case AddressingMode::ZeroPageY: return static_cast<Byte>(Operand + Y[Lane]);
+	case AddressingMode::AbsoluteX: return static_cast<Word>(Operand + X[Lane]);
+	case AddressingMode::AbsoluteY: return static_cast<Word>(Operand + Y[Lane]);
+	default: return Operand;
+	}
+}
+
+void m6502::Lockstep::ReadOperands(u32 Group, Byte Opcode, Word Operand)
+{
+	const OpcodeInfo& Info = OpcodeTable[Opcode];
+	if (Info.Mode == AddressingMode::Immediate)
+	{
+		Store(Operands, Splat(static_cast<Byte>(Operand)));
+		return;
+	}
+	for (u32 Lanes = Group; Lanes; Lanes &= Lanes - 1)
+	{
+		const u32 Lane = LowestLane(Lanes);
+		const Word Address = OperandAddress(Lane, Opcode, Operand);
+		// indexing past the end of the page costs a cycle, like CPU::AddrAbsoluteOffset
+		if (Info.PageCrossPenalty && (Address & 0x00FF) < (Operand & 0x00FF))
+		{
+			Remaining[Lane] -= Info.PageCrossPenalty;
+		}
+		Operands[Lane] = Memories[Lane]->Read(Address);
+	}
+}
+
+bool m6502::Lockstep::StepGroup(u32 Group, Byte Opcode, Word Operand)
+{
+	const OpcodeInfo& Info = OpcodeTable[Opcode];
+	const Word Pc = PC[LowestLane(Group)];
+	const Word Next = static_cast<Word>(Pc + Info.Length);
+	// every lane at once, branch free so the compiler vectorises it
+	for (u32 Lane = 0; Lane < MAX_LANES; Lane++)
+	{
+		const u32 In = (Group >> Lane) & 1;
+		PC[Lane] = In ? Next : PC[Lane];
+		Remaining[Lane] -= In * Info.Cycles;
+	}
+
+	const Vec Mask = LaneMask(Group);
+	auto SetNZ = [&](Vec Value)
+	{
+		Assign(N, BitOf<7>(Value), Mask);
+		Assign(Z, IsZero(Value), Mask);
+	};
+	auto Load_ = [&](Byte* Register)
+	{
+		ReadOperands(Group, Opcode, Operand);
+		const Vec Value = Load(Operands);
+		Assign(Register, Value, Mask);
+		SetNZ(Value);
+	};
+	auto Logic = [&](Vec Value)
+	{
+		Assign(A, Value, Mask);
+		SetNZ(Value);
+	};
+	auto Transfer = [&](const Byte* From, Byte* To)
+	{
+		const Vec Value = Load(From);
+		Assign(To, Value, Mask);
+		SetNZ(Value);
+	};
+	auto Step = [&](Byte* Register, Byte Delta)
+	{
+		const Vec Value = Load(Register) + Splat(Delta);
+		Assign(Register, Value, Mask);
+		SetNZ(Value);
+	};
+	auto StoreRegister = [&](const Byte* Register)
+	{
+		for (u32 Lanes = Group; Lanes; Lanes &= Lanes - 1)
+		{
+			const u32 Lane = LowestLane(Lanes);
+			const Word Address = OperandAddress(Lane, Opcode, Operand);
+			Memories[Lane]->Write(Address, Register[Lane]);
+			Written(Lane, Address);
+		}
+	};
+	auto Modify = [&](Byte Delta)
+	{
+		for (u32 Lanes = Group; Lanes; Lanes &= Lanes - 1)
+		{
+			const u32 Lane = LowestLane(Lanes);
+			const Word Address = OperandAddress(Lane, Opcode, Operand);
+			const Byte Value = static_cast<Byte>(Memories[Lane]->Read(Address) + Delta);
+			Memories[Lane]->Write(Address, Value);
+			Written(Lane, Address);
+			N[Lane] = Value >> 7;
+			Z[Lane] = Value == 0;
+		}
+	};
+	/* @return true if the group stays together */
+	auto Branch = [&](const Byte* Flag, Byte Taken)
+	{
+		const u32 TakenLanes = Bits(Equal(Load(Flag), Splat(Taken))) & Group;
+		const Word Target = static_cast<Word>(Next + static_cast<sByte>(Operand));
+		const s32 Penalty = Info.BranchPenalty + (((Target & 0xFF00) != (Next & 0xFF00)) ? Info.PageCrossPenalty : 0);
+		for (u32 Lanes = TakenLanes; Lanes; Lanes &= Lanes - 1)
+		{
+			const u32 Lane = LowestLane(Lanes);
+			PC[Lane] = Target;
+			Remaining[Lane] -= Penalty;
+		}
+		return TakenLanes == 0 || TakenLanes == Group;
+	};
+
+	// the vector forms, every other instruction runs the interpreter's handler lane by lane
+	switch (Opcode)
+	{
+	case CPU::INS_LDA_IM: case CPU::INS_LDA_ZP: case CPU::INS_LDA_ZPX: case CPU::INS_LDA_ABS:
+	case CPU::INS_LDA_ABSX: case CPU::INS_LDA_ABSY:
+		Load_(A);
+		return true;
+	case CPU::INS_LDX_IM: case CPU::INS_LDX_ZP: case CPU::INS_LDX_ZPY: case CPU::INS_LDX_ABS: case CPU::INS_LDX_ABSY:
+		Load_(X);
+		return true;
+	case CPU::INS_LDY_IM: case CPU::INS_LDY_ZP: case CPU::INS_LDY_ZPX: case CPU::INS_LDY_ABS: case CPU::INS_LDY_ABSX:
+		Load_(Y);
+		return true;
+
+	case CPU::INS_AND_IM: case CPU::INS_AND_ZP: case CPU::INS_AND_ZPX: case CPU::INS_AND_ABS:
+	case CPU::INS_AND_ABSX: case CPU::INS_AND_ABSY:
+		ReadOperands(Group, Opcode, Operand);
+		Logic(Load(A) & Load(Operands));
+		return true;
+	case CPU::INS_XOR_IM: case CPU::INS_XOR_ZP: case CPU::INS_XOR_ZPX: case CPU::INS_XOR_ABS:
+	case CPU::INS_XOR_ABSX: case CPU::INS_XOR_ABSY:
+		ReadOperands(Group, Opcode, Operand);
+		Logic(Load(A) ^ Load(Operands));
+		return true;
+	case CPU::INS_OR_IM: case CPU::INS_OR_ZP: case CPU::INS_OR_ZPX: case CPU::INS_OR_ABS:
+	case CPU::INS_OR_ABSX: case CPU::INS_OR_ABSY:
+		ReadOperands(Group, Opcode, Operand);
+		Logic(Load(A) | Load(Operands));
+		return true;
+
+	case CPU::INS_STA_ZP: case CPU::INS_STA_ZPX: case CPU::INS_STA_ABS: case CPU::INS_STA_ABSX: case CPU::INS_STA_ABSY:
+		StoreRegister(A);
+		return true;
+	case CPU::INS_STX_ZP: case CPU::INS_STX_ZPY: case CPU::INS_STX_ABS:
+		StoreRegister(X);
+		return true;
+	case CPU::INS_STY_ZP: case CPU::INS_STY_ZPX: case CPU::INS_STY_ABS:
+		StoreRegister(Y);
+		return true;
+	case CPU::INS_INC_ZP: case CPU::INS_INC_ZPX: case CPU::INS_INC_ABS: case CPU::INS_INC_ABSX:
+		Modify(1);
+		return true;
+	case CPU::INS_DEC_ZP: case CPU::INS_DEC_ZPX: case CPU::INS_DEC_ABS: case CPU::INS_DEC_ABSX:
+		Modify(0xFF);
+		return true;
+
+	case CPU::INS_TAX: Transfer(A, X); return true;
+	case CPU::INS_TAY: Transfer(A, Y); return true;
+	case CPU::INS_TXA: Transfer(X, A); return true;
+	case CPU::INS_TYA: Transfer(Y, A); return true;
+	case CPU::INS_TSX: Transfer(SP, X); return true;
+	case CPU::INS_TXS: Transfer(X, SP); return true;
+	case CPU::INS_INX: Step(X, 1); return true;
+	case CPU::INS_INY: Step(Y, 1); return true;
+	case CPU::INS_DEX: Step(X, 0xFF); return true;
+	case CPU::INS_DEY: Step(Y, 0xFF); return true;
+
+	case CPU::INS_CLC: Assign(C, Splat(0), Mask); return true;
+	case CPU::INS_SEC: Assign(C, Splat(1), Mask); return true;
+	case CPU::INS_CLI: Assign(I, Splat(0), Mask); return true;
+	case CPU::INS_SEI: Assign(I, Splat(1), Mask); return true;
+	case CPU::INS_CLV: Assign(V, Splat(0), Mask); return true;
+	case CPU::INS_CLD: Assign(D, Splat(0), Mask); return true;
+	case CPU::INS_SED: Assign(D, Splat(1), Mask); return true;
+	case CPU::INS_NOP: return true;
+
+	case CPU::INS_BEQ: return Branch(Z, 1);
+	case CPU::INS_BNE: return Branch(Z, 0);
+	case CPU::INS_BMI: return Branch(N, 1);
+	case CPU::INS_BPL: return Branch(N, 0);
+	case CPU::INS_BVS: return Branch(V, 1);
+	case CPU::INS_BVC: return Branch(V, 0);
+	case CPU::INS_BCS: return Branch(C, 1);
+	case CPU::INS_BCC: return Branch(C, 0);
+
+	case CPU::INS_JMP_ABS:
+		for (u32 Lanes = Group; Lanes; Lanes &= Lanes - 1)
+		{
+			PC[LowestLane(Lanes)] = Operand;
+		}
+		return true;
+
+	default:
+		return StepHandler(Group, Opcode, Operand);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "main_6502.h"
+
+/** Up to MAX_LANES CPUs running the same code on inputs of their own, each on its own Mem,
+*	stepped together (fuzzing, parameter sweeps). Lanes at the same PC with the same
+*	instruction bytes are a group: the instruction is decoded once and runs for the whole
+*	group on registers held one byte per lane, 32 lanes to a vector (AVX2 when the build
+*	targets it, SSE2 on other x86-64, plain loops elsewhere); memory accesses still go lane
+*	by lane. Loads, logic, transfers, stores, INC/DEC, flag changes, branches and JMP have
+*	that vector form, the other instructions run the handlers of the interpreter (Ops::)
+*	lane by lane, still decoded once for the group. Lanes a branch or RTS splits are
+*	regrouped, the lowest PC first so they meet again after it. The indirect modes and
+*	code outside RAM or ROM run lane by lane on CPU::Interpret. Every lane ends exactly
+*	as CPU::Execute would have left it, and like it an opcode that is not handled throws. */
+struct m6502::Lockstep
+{
+	static constexpr u32 MAX_LANES = 32;
+
+	/* Adds a lane starting from cpu's registers on memory, which must outlive the lane.
+	*	@return its index, or MAX_LANES if all are taken */
+	u32 AddLane(const CPU& cpu, Mem& memory);
+
+	/* Copies the registers of Lane to cpu */
+	void GetLane(u32 Lane, CPU& cpu) const;
+
+	/* Runs every lane for Cycles cycles, like CPU::Execute on each; Used tells how many each used */
+	void Execute(s32 Cycles);
+
+	u32 Lanes = 0;
+	s32 Used[MAX_LANES] = {};		// cycles each lane used in the last Execute
+
+	u64 GroupSteps = 0;			// instructions run for a group at once
+	u64 LaneSteps = 0;			// instructions run lane by lane
+
+	/* The registers, one array per register, lane i at index i. Flags are 0 or 1. */
+	alignas(32) Byte A[MAX_LANES] = {};
+	alignas(32) Byte X[MAX_LANES] = {};
+	alignas(32) Byte Y[MAX_LANES] = {};
+	alignas(32) Byte SP[MAX_LANES] = {};
+	alignas(32) Byte C[MAX_LANES] = {};
+	alignas(32) Byte Z[MAX_LANES] = {};
+	alignas(32) Byte I[MAX_LANES] = {};
+	alignas(32) Byte D[MAX_LANES] = {};
+	alignas(32) Byte V[MAX_LANES] = {};
+	alignas(32) Byte N[MAX_LANES] = {};
+	alignas(32) Byte B[MAX_LANES] = {};
+	alignas(32) Byte Unused[MAX_LANES] = {};
+	Word PC[MAX_LANES] = {};
+	Mem* Memories[MAX_LANES] = {};
+
+private:
+	/* Runs the instruction at PC for the lanes of Group, which must be handled and not indirect.
+	*	@return false if a branch split the group */
+	bool StepGroup(u32 Group, Byte Opcode, Word Operand);
+
+	/* Runs the handler of Opcode for each lane of Group, PC already past the instruction
+	*	and its base cycles paid. @return false if the lanes did not all end at the same PC */
+	bool StepHandler(u32 Group, Byte Opcode, Word Operand);
+
+	/* Runs one instruction of Lane on CPU::Interpret */
+	void StepLane(u32 Lane);
+
+	/* Copies the registers and flags of Lane to cpu's Status, or back from it */
+	void LoadLane(u32 Lane, CPU& cpu) const;
+	void SaveLane(u32 Lane, CPU& cpu);
+
+	/* Fills Operands for the lanes of Group from the addressing mode of Opcode,
+	*	charging the page crossing penalty */
+	void ReadOperands(u32 Group, Byte Opcode, Word Operand);
+
+	/* Effective address of the operand of Opcode in Lane, for the modes ReadOperands takes */
+	Word OperandAddress(u32 Lane, Byte Opcode, Word Operand) const;
+
+	/* @return the lanes whose code page Page holds the same bytes as Lead's */
+	u32 SameCodeAs(u32 Lead, u32 Page);
+
+	/* Forgets what SameCodeAs knows of the page of Address, Lane wrote to it */
+	void Written(u32 Lane, Word Address);
+
+	s32 Remaining[MAX_LANES] = {};
+	alignas(32) Byte Operands[MAX_LANES] = {};
+	CPU Scratch;
+
+	/* Lanes whose page holds the same code, compared once instead of on every instruction.
+	*	It holds while CodeGeneration[Page] is Generation: a write to the page forgets it,
+	*	a write that could have changed any page (a device, a lane stepped alone) all of them. */
+	u32 SameCode[Mem::NUM_PAGES] = {};
+	u32 CodeGeneration[Mem::NUM_PAGES] = {};
+	u32 Generation = 0;
+};
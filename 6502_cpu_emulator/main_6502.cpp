@@ -1,878 +1,393 @@
+#include <atomic>
+#include <cstring>
 #include "main_6502.h"
+#include "opcode_info_6502.h"
+#include "opcodes_6502.h"
+#include "rom_image_6502.h"
 
-m6502::Word m6502::CPU::AddrZeroPage(s32& Cycles, const Mem& memory)
+/* GCC and Clang support labels as values: use the threaded interpreter core
+*	unless the build asks for the portable switch dispatch with -DM6502_THREADED_DISPATCH=0 */
+#ifndef M6502_THREADED_DISPATCH
+#if defined(__GNUC__)
+#define M6502_THREADED_DISPATCH 1
+#else
+#define M6502_THREADED_DISPATCH 0
+#endif
+#endif
+
+m6502::u32 m6502::Mem::NewId()
+{
+	static std::atomic<u32> NextId{ 1 };
+	return NextId++;
+}
+
+void m6502::Mem::MapRam(u32 FirstPage, u32 Pages)
+{
+	for (u32 Page = FirstPage; Page < FirstPage + Pages && Page < NUM_PAGES; Page++)
+	{
+		MapPage(Page, &Data[Page * PAGE_SIZE], &Data[Page * PAGE_SIZE], nullptr);
+	}
+}
+
+void m6502::Mem::MapRom(u32 FirstPage, u32 Pages, const Byte* Rom)
 {
-	Byte ZeroPageAddr = FetchByte(Cycles, memory);
-	return ZeroPageAddr;
+	for (u32 Page = FirstPage; Page < FirstPage + Pages && Page < NUM_PAGES; Page++)
+	{
+		MapPage(Page, &Rom[(Page - FirstPage) * PAGE_SIZE], &Data[Page * PAGE_SIZE], nullptr);
+	}
 }
 
-m6502::Word m6502::CPU::AddrZeroPageOffset(s32& Cycles, const Mem& memory, Byte Offset)
+void m6502::Mem::MapIo(u32 FirstPage, u32 Pages, IoDevice* Device)
 {
-	Byte ZeroPageAddr = FetchByte(Cycles, memory);
-	ZeroPageAddr += Offset;
-	Cycles--;
-	return ZeroPageAddr;
+	for (u32 Page = FirstPage; Page < FirstPage + Pages && Page < NUM_PAGES; Page++)
+	{
+		MapPage(Page, nullptr, nullptr, Device);
+	}
 }
 
-m6502::Word m6502::CPU::AddrAbsolute(s32& Cycles, const Mem& memory)
+void m6502::Mem::MapPort(IoDevice* Device)
 {
-	Word AbsAddr = FetchWord(Cycles, memory);
-	return AbsAddr;
+	if (Port == Device)
+	{
+		return;
+	}
+	Port = Device;
+	PageMapVersion[0]++;
+	MapVersion++;
 }
 
-m6502::Word m6502::CPU::AddrAbsoluteOffset(s32& Cycles, const Mem& memory, Byte Offset)
+void m6502::Mem::MapPage(u32 Page, const Byte* Read, Byte* Write, IoDevice* Device)
 {
-	Word AbsAddr = FetchWord(Cycles, memory);
-	Word AbsAddrX = AbsAddr + Offset;
-	if ((AbsAddrX & 0x00FF) < (AbsAddr & 0x00FF))
+	if (ReadPages[Page] == Read && WritePages[Page] == Write && Devices[Page] == Device)
 	{
-		Cycles--;
+		return;
 	}
-	return AbsAddrX;
+	ReadPages[Page] = Read;
+	WritePages[Page] = Write;
+	Devices[Page] = Device;
+	PageVersion[Page]++;
+	PageMapVersion[Page]++;
+	MapVersion++;
 }
 
-m6502::Word m6502::CPU::AddrIndirectX(s32& Cycles, const Mem& memory)
+void m6502::Mem::Initialise()
 {
-	Byte ZPAddress = FetchByte(Cycles, memory);
-	Byte ZPAddressX = ZPAddress + X;
-	Cycles--;
-	Word EffectiveAddress = ReadWord(Cycles, ZPAddressX, memory);
-	return EffectiveAddress;
+	for (u32 Page = 0; Page < NUM_PAGES; Page++)
+	{
+		if (ClearedVersion[Page] != PageVersion[Page])
+		{
+			std::memset(&Data[Page * PAGE_SIZE], 0, PAGE_SIZE);
+			PageWritten(Page);
+			ClearedVersion[Page] = PageVersion[Page];
+		}
+	}
 }
 
-m6502::Word m6502::CPU::AddrIndirectY(s32& Cycles, const Mem& memory)
+void m6502::Mem::PageWritten(u32 Page)
 {
-	Word ZPAddress = FetchByte(Cycles, memory);
-	Word EffectiveAddress = ReadWord(Cycles, ZPAddress, memory);
-	Word EffectiveAddressY = EffectiveAddress + Y;
-	if ((EffectiveAddressY & 0x00FF) < (EffectiveAddress & 0x00FF))
+	PageVersion[Page]++;
+#if M6502_DIRTY_MAP
+	DirtyPages[Page / 64] |= u64(1) << (Page % 64);
+	for (u32 i = 0; i < PAGE_SIZE / 64; i++)
 	{
-		Cycles--;
+		DirtyBytes[Page * PAGE_SIZE / 64 + i] = ~u64(0);
 	}
-	return EffectiveAddressY;
+#endif
 }
 
-m6502::Word m6502::CPU::AddrAbsoluteOffsetStore(s32& Cycles, const Mem& memory, Byte Offset)
+bool m6502::Mem::RangeDirty(u32 First, u32 Count) const
 {
-	Word AbsAddr = FetchWord(Cycles, memory);
-	Word AbsAddrX = AbsAddr + Offset;
-	Cycles--;
-	return AbsAddrX;
+#if M6502_DIRTY_MAP
+	const u32 End = First + Count;
+	for (u32 Address = First; Address < End && Address < MAX_MEM; )
+	{
+		// whole clean pages are skipped with their page bit, whole words of bytes at once
+		if (Address % PAGE_SIZE == 0 && !PageDirty(Address / PAGE_SIZE))
+		{
+			Address += PAGE_SIZE;
+			continue;
+		}
+		const u32 Bit = Address % 64;
+		const u32 Bits = (End - Address < 64 - Bit) ? End - Address : 64 - Bit;
+		const u64 Mask = (Bits == 64) ? ~u64(0) : ((u64(1) << Bits) - 1) << Bit;
+		if (DirtyBytes[Address / 64] & Mask)
+		{
+			return true;
+		}
+		Address += Bits;
+	}
+	return false;
+#else
+	(void)First;
+	return Count > 0;
+#endif
 }
 
-m6502::Word m6502::CPU::AddrIndirectYStore(s32& Cycles, const Mem& memory)
+m6502::u32 m6502::Mem::NextDirtyPage(u32 Page) const
 {
-	Word ZPAddress = FetchByte(Cycles, memory);
-	Word EffectiveAddress = ReadWord(Cycles, ZPAddress, memory);
-	Word EffectiveAddressY = EffectiveAddress + Y;
-	Cycles--;
-	return EffectiveAddressY;
+#if M6502_DIRTY_MAP
+	while (Page < NUM_PAGES && !PageDirty(Page))
+	{
+		// a whole word of clean pages at once
+		Page = (Page % 64 == 0 && DirtyPages[Page / 64] == 0) ? Page + 64 : Page + 1;
+	}
+#endif
+	return Page < NUM_PAGES ? Page : NUM_PAGES;
 }
 
-void m6502::CPU::BranchCondition(s32& Cycles, const Mem& memory, bool condition)
+void m6502::Mem::ClearDirty(u32 FirstPage, u32 Pages)
 {
-	Byte Offset = FetchByte(Cycles, memory);
-	if (condition) {
-		Word Address = PC + static_cast<sByte>(Offset);
-		if ((Address & 0xFF00) != (PC & 0xFF00))
+#if M6502_DIRTY_MAP
+	for (u32 Page = FirstPage; Page < FirstPage + Pages && Page < NUM_PAGES; Page++)
+	{
+		DirtyPages[Page / 64] &= ~(u64(1) << (Page % 64));
+		for (u32 i = 0; i < PAGE_SIZE / 64; i++)
 		{
-			Cycles -= 2;
+			DirtyBytes[Page * PAGE_SIZE / 64 + i] = 0;
 		}
-		PC = Address;
-		Cycles--;
 	}
+#else
+	(void)FirstPage;
+	(void)Pages;
+#endif
 }
 
-m6502::Word m6502::CPU::LoadPrg(Byte* Program, u32 nBytes, Mem& memory)
+m6502::Byte m6502::Mem::ReadDevice(Word Address) const
+{
+	DeviceAccesses++;
+	return Devices[Address / PAGE_SIZE]->Read(Address);
+}
+
+void m6502::Mem::WriteDevice(Word Address, Byte Value)
+{
+	IoDevice* Device = (Address < PORT_BYTES && Port) ? Port : Devices[Address / PAGE_SIZE];
+	DeviceAccesses++;
+	Device->Write(Address, Value);
+}
+
+void m6502::Mem::CopyFrom(const Mem& Other)
+{
+	const Byte* OtherData = Other.Data;
+	for (u32 i = 0; i < MAX_MEM; i++) {
+		Data[i] = Other.Data[i];
+	}
+	for (u32 Page = 0; Page < NUM_PAGES; Page++) {
+		const Byte* Read = Other.ReadPages[Page];
+		const Byte* Write = Other.WritePages[Page];
+		const bool ReadsRam = Read >= OtherData && Read < OtherData + MAX_MEM;
+		const bool WritesRam = Write >= OtherData && Write < OtherData + MAX_MEM;
+		ReadPages[Page] = ReadsRam ? &Data[Read - OtherData] : Read;
+		WritePages[Page] = WritesRam ? &Data[Write - OtherData] : Other.WritePages[Page];
+		Devices[Page] = Other.Devices[Page];
+		if (Devices[Page] && Devices[Page]->BoundTo() && Devices[Page]->BoundTo() != this)
+		{
+			// it would work on Other's RAM, not on this one
+			ReadPages[Page] = ReadPages[Page] ? ReadPages[Page] : &Data[Page * PAGE_SIZE];
+			WritePages[Page] = &Data[Page * PAGE_SIZE];
+			Devices[Page] = nullptr;
+		}
+		PageWritten(Page);
+		PageMapVersion[Page]++;
+		ClearedVersion[Page] = PageVersion[Page] - 1;
+	}
+	Port = (Other.Port && Other.Port->BoundTo() && Other.Port->BoundTo() != this) ? nullptr : Other.Port;
+	MapVersion++;
+}
+
+m6502::Word m6502::CPU::LoadPrg(const Byte* Program, u32 nBytes, Mem& memory)
 {
 	m6502::Word LoadAddress = 0x0000;
 	if (Program && nBytes >  2)
 	{
-		u32 At = 0x00;
-		LoadAddress = ((m6502::Word)Program[At]) | (((m6502::Word)Program[At+1]) << 8);
-		At += 2;
-		for(int i = LoadAddress; i < LoadAddress+nBytes-2; i++)
+		LoadAddress = ((m6502::Word)Program[0]) | (((m6502::Word)Program[1]) << 8);
+		u32 Bytes = nBytes - 2;
+		if (LoadAddress + Bytes > Mem::MAX_MEM)
+		{
+			Bytes = Mem::MAX_MEM - LoadAddress;
+		}
+		std::memcpy(&memory.Data[LoadAddress], &Program[2], Bytes);
+		for (u32 Page = LoadAddress / Mem::PAGE_SIZE; Page <= (LoadAddress + Bytes - 1) / Mem::PAGE_SIZE; Page++)
 		{
-			memory[i] = Program[At++];
+			memory.PageWritten(Page);
 		}
 	}
 	return LoadAddress;
+}
 
+bool m6502::CPU::LoadPrgFile(const char* Path, Mem& memory, Word& LoadAddress)
+{
+	const std::shared_ptr<const RomImage> Image = RomImage::Open(Path);
+	if (!Image || Image->Size() <= 2)
+	{
+		return false;
+	}
+	const u32 Start = Image->Data()[0] | (Image->Data()[1] << 8);
+	if (Start + Image->Size() - 2 > Mem::MAX_MEM)
+	{
+		return false;
+	}
+	LoadAddress = LoadPrg(Image->Data(), Image->Size(), memory);
+	return true;
 }
 
-/* @return the number of cycles that were used */
-m6502::s32 m6502::CPU::Execute(s32 Cycles, Mem& memory)
+namespace
 {
-	auto LoadRegister = [this, &Cycles, &memory](Word Address, Byte& Register)
+	using namespace m6502;
+
+	/* 256 entry dispatch table indexed by the opcode, lengths and cycles are in OpcodeTable */
+	struct OpTableType
 	{
-		Register = ReadByte(Cycles, Address, memory);
-		LoadRegisterSetStatus(Register);
+		OpHandler Handlers[256];
 	};
 
+	constexpr OpTableType MakeOpTable()
+	{
+		OpTableType Table{};
+		for (u32 i = 0; i < 256; i++)
+		{
+			Table.Handlers[i] = Ops::Op_NotHandled;
+		}
+#define M6502_BIND_OPCODE(Name, Mnemonic, Mode, Length, Cycles, PageCross, Branch) \
+		Table.Handlers[CPU::INS_##Name] = Ops::Op_##Name;
+		M6502_HANDLED_OPCODES(M6502_BIND_OPCODE)
+#undef M6502_BIND_OPCODE
+		return Table;
+	}
+
+	constexpr OpTableType OpTable = MakeOpTable();
+
+	/* Fetches the operand bytes that follow the opcode */
+	inline Word FetchOperand(CPU& cpu, Byte Length, const Mem& memory)
+	{
+		switch (Length)
+		{
+		case 2: return cpu.FetchByte(memory);
+		case 3: return cpu.FetchWord(memory);
+		default: return 0;
+		}
+	}
+
+	/* Same, for a Length known at compile time: every instantiation only has the reads
+	*	it needs, small enough to be inlined in each label or case of the interpreter core */
+	template <Byte Length>
+	M6502_FORCE_INLINE Word FetchOperand(CPU& cpu, const Mem& memory)
+	{
+		return (Length == 3) ? cpu.FetchWord(memory) : (Length == 2) ? cpu.FetchByte(memory) : 0;
+	}
+}
+
+m6502::MicroOp m6502::CPU::Decode(Word Address, const Mem& memory)
+{
+	MicroOp Op;
+	Op.Opcode = memory.Read(Address);
+	Op.Length = OpcodeTable[Op.Opcode].Length;
+	Op.Cycles = OpcodeTable[Op.Opcode].Cycles;
+	Op.Handler = (OpTable.Handlers[Op.Opcode] != Ops::Op_NotHandled) ? OpTable.Handlers[Op.Opcode] : nullptr;
+	switch (Op.Length)
+	{
+	case 2: Op.Operand = memory.Read(static_cast<Word>(Address + 1)); break;
+	case 3: Op.Operand = memory.Read(static_cast<Word>(Address + 1)) |
+			(memory.Read(static_cast<Word>(Address + 2)) << 8); break;
+	default: Op.Operand = 0; break;
+	}
+	return Op;
+}
+
+#if M6502_THREADED_DISPATCH
+
+/* Expands X(Op) once for every opcode, Op is the opcode in hex without the 0x prefix */
+#define M6502_FOR_EACH_OPCODE(X) \
+	X(00) X(01) X(02) X(03) X(04) X(05) X(06) X(07) X(08) X(09) X(0A) X(0B) X(0C) X(0D) X(0E) X(0F) \
+	X(10) X(11) X(12) X(13) X(14) X(15) X(16) X(17) X(18) X(19) X(1A) X(1B) X(1C) X(1D) X(1E) X(1F) \
+	X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(2A) X(2B) X(2C) X(2D) X(2E) X(2F) \
+	X(30) X(31) X(32) X(33) X(34) X(35) X(36) X(37) X(38) X(39) X(3A) X(3B) X(3C) X(3D) X(3E) X(3F) \
+	X(40) X(41) X(42) X(43) X(44) X(45) X(46) X(47) X(48) X(49) X(4A) X(4B) X(4C) X(4D) X(4E) X(4F) \
+	X(50) X(51) X(52) X(53) X(54) X(55) X(56) X(57) X(58) X(59) X(5A) X(5B) X(5C) X(5D) X(5E) X(5F) \
+	X(60) X(61) X(62) X(63) X(64) X(65) X(66) X(67) X(68) X(69) X(6A) X(6B) X(6C) X(6D) X(6E) X(6F) \
+	X(70) X(71) X(72) X(73) X(74) X(75) X(76) X(77) X(78) X(79) X(7A) X(7B) X(7C) X(7D) X(7E) X(7F) \
+	X(80) X(81) X(82) X(83) X(84) X(85) X(86) X(87) X(88) X(89) X(8A) X(8B) X(8C) X(8D) X(8E) X(8F) \
+	X(90) X(91) X(92) X(93) X(94) X(95) X(96) X(97) X(98) X(99) X(9A) X(9B) X(9C) X(9D) X(9E) X(9F) \
+	X(A0) X(A1) X(A2) X(A3) X(A4) X(A5) X(A6) X(A7) X(A8) X(A9) X(AA) X(AB) X(AC) X(AD) X(AE) X(AF) \
+	X(B0) X(B1) X(B2) X(B3) X(B4) X(B5) X(B6) X(B7) X(B8) X(B9) X(BA) X(BB) X(BC) X(BD) X(BE) X(BF) \
+	X(C0) X(C1) X(C2) X(C3) X(C4) X(C5) X(C6) X(C7) X(C8) X(C9) X(CA) X(CB) X(CC) X(CD) X(CE) X(CF) \
+	X(D0) X(D1) X(D2) X(D3) X(D4) X(D5) X(D6) X(D7) X(D8) X(D9) X(DA) X(DB) X(DC) X(DD) X(DE) X(DF) \
+	X(E0) X(E1) X(E2) X(E3) X(E4) X(E5) X(E6) X(E7) X(E8) X(E9) X(EA) X(EB) X(EC) X(ED) X(EE) X(EF) \
+	X(F0) X(F1) X(F2) X(F3) X(F4) X(F5) X(F6) X(F7) X(F8) X(F9) X(FA) X(FB) X(FC) X(FD) X(FE) X(FF)
+
+/* @return the number of cycles that were used
+*	Threaded dispatch: every handler ends with its own indirect jump to the
+*	next opcode's label, so the host predictor keeps a history per opcode */
+m6502::s32 m6502::CPU::Interpret(s32 Cycles, Mem& memory)
+{
+#define M6502_OP_LABEL_ADDRESS(Op) &&Label_##Op,
+	static void* const Dispatch[256] = { M6502_FOR_EACH_OPCODE(M6502_OP_LABEL_ADDRESS) };
+#undef M6502_OP_LABEL_ADDRESS
+
+	const u32 CycleRequested = Cycles;
+	Byte Ins;
+
+#define M6502_DISPATCH()						\
+	if (Cycles <= 0) goto Done;					\
+	Ins = FetchByte(memory);					\
+	goto *Dispatch[Ins];
+
+	M6502_DISPATCH();
+
+	// OpTable and OpcodeTable are constexpr, so each label below charges its
+	// cycles with one constant subtraction and makes a direct, inlinable call
+#define M6502_OP_LABEL(Op)												\
+	Label_##Op:															\
+	Cycles -= OpcodeTable[0x##Op].Cycles;								\
+	OpTable.Handlers[0x##Op](*this, Cycles, memory,						\
+		FetchOperand<OpcodeTable[0x##Op].Length>(*this, memory));		\
+	M6502_DISPATCH();
+	M6502_FOR_EACH_OPCODE(M6502_OP_LABEL)
+#undef M6502_OP_LABEL
+#undef M6502_DISPATCH
+
+Done:
+	const s32 NumCyclesUsed = CycleRequested - Cycles;
+	return NumCyclesUsed;
+}
+
+#else
+
+/* @return the number of cycles that were used
+*	Switch dispatch, for compilers without labels as values: each case charges
+*	its constant cycles and calls its handler directly, so it can be inlined.
+*	Calling through OpTable instead measured slower than this switch. */
+m6502::s32 m6502::CPU::Interpret(s32 Cycles, Mem& memory)
+{
 	const u32 CycleRequested = Cycles;
 	while (Cycles > 0)
 	{
-		Byte Ins = FetchByte(Cycles, memory);
+		const Byte Ins = FetchByte(memory);
 		switch (Ins)
 		{
-		case INS_LDA_IM:
-		{
-			A = FetchByte(Cycles, memory);
-			LoadRegisterSetStatus(A);
-		} break;
-		case INS_LDX_IM:
-		{
-			X = FetchByte(Cycles, memory);
-			LoadRegisterSetStatus(X);
-		} break;
-		case INS_LDY_IM:
-		{
-			Y = FetchByte(Cycles, memory);
-			LoadRegisterSetStatus(Y);
-		} break;
-		case INS_LDA_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			LoadRegister(Address, A);
-		}break;
-		case INS_LDX_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			LoadRegister(Address, X);
-		}break;
-		case INS_LDY_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			LoadRegister(Address, Y);
-		}break;
-		case INS_LDA_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			LoadRegister(Address, A);
-		}break;
-		case INS_LDX_ZPY:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, Y);
-			LoadRegister(Address, X);
-		}break;
-		case INS_LDY_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			LoadRegister(Address, Y);
-		}break;
-		case INS_LDA_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			LoadRegister(Address, A);
-		}break;
-		case INS_LDX_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			LoadRegister(Address, X);
-		}break;
-		case INS_LDY_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			LoadRegister(Address, Y);
-		}break;
-		case INS_LDA_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			LoadRegister(Address, A);
-		}break;
-		case INS_LDA_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			LoadRegister(Address, A);
-		}break;
-		case INS_LDX_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			LoadRegister(Address, X);
-		}break;
-		case INS_LDY_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			LoadRegister(Address, Y);
-		}break;
-		case INS_LDA_INDX:
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			LoadRegister(Address, A);
-		}break;
-		case INS_LDA_INDY:
-		{
-			Word Address = AddrIndirectY(Cycles, memory);
-			LoadRegister(Address, A);
-		}break;
-		case INS_STA_ZP:
-		{
-			Byte Address = AddrZeroPage(Cycles, memory);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_STA_ZPX:
-		{
-			Byte Address = AddrZeroPageOffset(Cycles, memory, X);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_STA_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_STA_ABSX:
-		{
-			Word Address = AddrAbsoluteOffsetStore(Cycles, memory, X);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_STA_ABSY:
-		{
-			Word Address = AddrAbsoluteOffsetStore(Cycles, memory, Y);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_STX_ZP:
-		{
-			Byte Address = AddrZeroPage(Cycles, memory);
-			WriteByte(X, Address, Cycles, memory);
-		}break;
-		case INS_STX_ZPY:
-		{
-			Byte Address = AddrZeroPageOffset(Cycles, memory, Y);
-			WriteByte(X, Address, Cycles, memory);
-		}break;
-		case INS_STY_ZP:
-		{
-			Byte Address = AddrZeroPage(Cycles, memory);
-			WriteByte(Y, Address, Cycles, memory);
-		}break;
-		case INS_STY_ZPX:
-		{
-			Byte Address = AddrZeroPageOffset(Cycles, memory, X);
-			WriteByte(Y, Address, Cycles, memory);
-		}break;
-		case INS_STX_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			WriteByte(X, Address, Cycles, memory);
-		}break;
-		case INS_STY_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			WriteByte(Y, Address, Cycles, memory);
-		}break;
-		case INS_STA_INDX:
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_STA_INDY:
-		{
-			Word Address = AddrIndirectYStore(Cycles, memory);
-			WriteByte(A, Address, Cycles, memory);
-		}break;
-		case INS_TSX:
-		{
-			X = SP;
-			LoadRegisterSetStatus(X);
-			Cycles--;
-		}break;
-		case INS_TXS:
-		{
-			SP = X;
-			LoadRegisterSetStatus(SP);
-			Cycles--;
-		}break;
-		case INS_TYA:
-		{
-			A = Y;
-			LoadRegisterSetStatus(A);
-			Cycles--;
-		}break;
-		case INS_TAY:
-		{
-			Y = A;
-			LoadRegisterSetStatus(Y);
-			Cycles--;
-		}break;
-		case INS_TXA:
-		{
-			A = X;
-			LoadRegisterSetStatus(A);
-			Cycles--;
-		}break;
-		case INS_TAX:
-		{
-			X = A;
-			LoadRegisterSetStatus(X);
-			Cycles--;
-		}break;
-		case INS_PHA:
-		{
-			PushByteOnTheStack(A, Cycles, memory);
-		}break;
-		case INS_PHP:
-		{
-			PushByteOnTheStack(PS.Reg, Cycles, memory);
-		}break;
-		case INS_PLA:
-		{
-			A = PopByteFromStack(Cycles, memory);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_PLP:
-		{
-			PS.Reg = PopByteFromStack(Cycles, memory);
-		}break;
-		case INS_INX:
-		{
-			X += 1;
-			LoadRegisterSetStatus(X);
-			Cycles--;
-		}break;
-		case INS_INY:
-		{
-			Y += 1;
-			LoadRegisterSetStatus(Y);
-			Cycles--;
-		}break;
-		case INS_DEX:
-		{
-			X -= 1;
-			LoadRegisterSetStatus(X);
-			Cycles--;
-		}break;
-		case INS_DEY:
-		{
-			Y -= 1;
-			LoadRegisterSetStatus(Y);
-			Cycles--;
-		}break;
-		case INS_INC_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			memory[Address] += 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_INC_ABSX:
-		{
-			Word Address = AddrAbsoluteOffsetStore(Cycles, memory, X);
-			memory[Address] += 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_INC_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			memory[Address] += 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_INC_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			memory[Address] += 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_DEC_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			memory[Address] -= 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_DEC_ABSX:
-		{
-			Word Address = AddrAbsoluteOffsetStore(Cycles, memory, X);
-			memory[Address] -= 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_DEC_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			memory[Address] -= 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_DEC_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			memory[Address] -= 1;
-			LoadRegisterSetStatus(memory[Address]);
-			Cycles -= 3;
-		}break;
-		case INS_AND_IM:
-		{
-			Byte Value = FetchByte(Cycles, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_INDX:
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_AND_INDY:
-		{
-			Word Address = AddrIndirectY(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A & Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_IM:
-		{
-			Byte Value = FetchByte(Cycles, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_INDX:
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_XOR_INDY:
-		{
-			Word Address = AddrIndirectY(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A ^ Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_IM:
-		{
-			Byte Value = FetchByte(Cycles, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_INDX:
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_OR_INDY:
-		{
-			Word Address = AddrIndirectY(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			A = (A | Value);
-			LoadRegisterSetStatus(A);
-		}break;
-		case INS_BIT_ZP:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			Byte Result = (A & Value);
-			PS.Flags.Z = (Result == 0x00);
-			PS.Flags.N = ((Value & 0b10000000) == 0b10000000);
-			PS.Flags.V = ((Value & 0b01000000) == 0b01000000);
-		}break;
-		case INS_BIT_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte Value = ReadByte(Cycles, Address, memory);
-			Byte Result = (A & Value);
-			PS.Flags.Z = (Result == 0x00);
-			PS.Flags.N = ((Value & 0b10000000) == 0b10000000);
-			PS.Flags.V = ((Value & 0b01000000) == 0b01000000);
-		}break;
-		case INS_BEQ:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.Z == 1);
-		}break;
-		case INS_BNE:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.Z == 0);
-		}break;
-		case INS_BPL:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.N == 0);
-		}break;
-		case INS_BMI:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.N == 1);
-		}break;
-		case INS_BVC:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.V == 0);
-		}break;
-		case INS_BVS:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.V == 1);
-		}break;
-		case INS_BCC:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.C == 0);
-		}break;
-		case INS_BCS:
-		{
-			BranchCondition(Cycles, memory, PS.Flags.C == 1);
-		}break;
-		case INS_CLC: 
-		{
-			PS.Flags.C = 0;
-			Cycles--;
-		}break;
-		case INS_SEC: 
-		{
-			PS.Flags.C = 1;
-			Cycles--;
-		}break;
-		case INS_CLI: 
-		{
-			PS.Flags.I = 0;
-			Cycles--;
-		}break;
-		case INS_SEI: 
-		{
-			PS.Flags.I = 1;
-			Cycles--;
-		}break;
-		case INS_CLV: 
-		{
-			PS.Flags.V = 0;
-			Cycles--;
-		}break;
-		case INS_CLD: 
-		{
-			PS.Flags.D = 0;
-			Cycles--;
-		}break;
-		case INS_SED: 
-		{
-			PS.Flags.D = 1;
-			Cycles--;
-		}break;
-		case INS_NOP:
-		{
-			Cycles--;
-		}break;
-		case INS_ADC_IM  :
-		{
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(FetchByte(Cycles, memory)) +
-				static_cast<Word>(0x01*PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_ZP  :
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_ZPX :
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_ABS :
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_INX :
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_ADC_INY :
-		{
-			Word Address = AddrIndirectY(Cycles, memory);
-			Word Result =
-				static_cast<Word>(A) +
-				static_cast<Word>(ReadByte(Cycles, Address, memory)) +
-				static_cast<Word>(0x01 * PS.Flags.C);
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_SBC_IM:
-		{
-			Byte Operand = ~FetchByte(Cycles, memory);
-			Byte Carry = 0x01 * PS.Flags.C;
-			Word Result = static_cast<Word>(A);
-			Result += (Operand);
-			Result += Carry;
-			SetADCFlags(Result);
-			A = static_cast<Byte>(Result & 0x00FF);
-		}break;
-		case INS_CMP_IM	:
-		{
-			Byte MemValue = FetchByte(Cycles, memory);
-			Byte Result	= A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_ZP	:
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_ZPX:
-		{
-			Word Address = AddrZeroPageOffset(Cycles, memory, X);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_ABSX:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, X);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_ABSY:
-		{
-			Word Address = AddrAbsoluteOffset(Cycles, memory, Y);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_INX:
-		{
-			Word Address = AddrIndirectX(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMP_INY:
-		{
-			Word Address = AddrIndirectY(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = A - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMX_IM :
-		{
-			Byte MemValue = FetchByte(Cycles, memory);
-			Byte Result = X - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMX_ZP :
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = X - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMX_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = X - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMY_IM :
-		{
-			Byte MemValue = FetchByte(Cycles, memory);
-			Byte Result = Y - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMY_ZP :
-		{
-			Word Address = AddrZeroPage(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = Y - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_CMY_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			Byte MemValue = ReadByte(Cycles, Address, memory);
-			Byte Result = Y - MemValue;
-			SetCMPFlags(Result);
-		}break;
-		case INS_JSR:
-		{
-			Word SubAddr = FetchWord(Cycles, memory);
-			PushPCToStack(Cycles, memory);
-			PC = SubAddr;
-			Cycles --;
-		}break;
-		case INS_RTS:
-		{
-			Word ReturnAddress = PopWordFromStack(Cycles, memory);
-			PC = ReturnAddress;
-			Cycles -= 2;
-		}break;
-		case INS_JMP_ABS:
-		{
-			Word Address = AddrAbsolute(Cycles, memory);
-			PC = Address;
-		}break;
-		case INS_JMP_IND:
-		{
-			Word IndAddress = AddrAbsolute(Cycles, memory);
-			Word Address = ReadWord(Cycles, IndAddress, memory);
-			PC = Address;
-		}break;
+#define M6502_OP_CASE(Name, Mnemonic, Mode, Length, OpCycles, PageCross, Branch)	\
+		case CPU::INS_##Name:														\
+			Cycles -= OpCycles;														\
+			Ops::Op_##Name(*this, Cycles, memory, FetchOperand<Length>(*this, memory));	\
+			break;
+		M6502_HANDLED_OPCODES(M6502_OP_CASE)
+#undef M6502_OP_CASE
 		default:
-		{
-
-			printf("Intruction not handled, Ins: %d\tCycles: %d\n", Ins, Cycles);
-			throw - 1;
-		}break;
+			Cycles -= OpcodeTable[Ins].Cycles;
+			Ops::Op_NotHandled(*this, Cycles, memory, FetchOperand(*this, OpcodeTable[Ins].Length, memory));
+			break;
 		}
 	}
 	const s32 NumCyclesUsed = CycleRequested - Cycles;
 	return NumCyclesUsed;
-}
\ No newline at end of file
+}
+
+#endif
+
+/* @return the number of cycles that were used */
+m6502::s32 m6502::CPU::Execute(s32 Cycles, Mem& memory)
+{
+	UnpackStatus();
+	const s32 NumCyclesUsed = Interpret(Cycles, memory);
+	PackStatus();
+	return NumCyclesUsed;
+}
@@ -5,6 +5,32 @@
 
 /* www.c64-wiki.com */
 
+/* Lazy N/Z flags (see CPU::SyncFlags), build with -DM6502_LAZY_FLAGS=0 to update them eagerly */
+#ifndef M6502_LAZY_FLAGS
+#define M6502_LAZY_FLAGS 1
+#endif
+
+/* Fast-forward loops that only burn cycles (see CPU::SkipIdleLoop), build with -DM6502_IDLE_SKIP=0 to run them */
+#ifndef M6502_IDLE_SKIP
+#define M6502_IDLE_SKIP 1
+#endif
+
+/* Dirty map of the RAM (see Mem::PageDirty), build with -DM6502_DIRTY_MAP=0 to leave it out,
+*	everything counts as dirty then */
+#ifndef M6502_DIRTY_MAP
+#define M6502_DIRTY_MAP 1
+#endif
+
+/* For the bus helpers: they are inlined in every label of the interpreter core,
+*	which is more than the compilers' own heuristics allow for such a large function */
+#if defined(_MSC_VER)
+#define M6502_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define M6502_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define M6502_FORCE_INLINE inline
+#endif
+
 namespace m6502
 {
 	using Byte = unsigned char;
@@ -13,38 +39,305 @@ namespace m6502
 
 	using u32 = unsigned int;
 	using s32 = signed int;
+	using u64 = unsigned long long;
 
+	struct IoDevice;
 	struct Mem;
+	struct MemSnapshot;
 	struct CPU;
 	struct StatusFlags;
+	struct HostFlags;
+	struct IdleLoop;
+	struct MicroOp;
+	struct DecodeCache;
+	struct Jit;
+	struct C64Banking;
+	struct C64Roms;
+	struct RomImage;
+	struct SparseMem;
+	struct Machine;
+	struct InstancePool;
+	struct BatchRegisters;
+	struct BatchRange;
+	struct BatchJob;
+	struct BatchResult;
+	struct Lockstep;
+	struct CPUView;
+	struct CPUPool;
+	struct ForkServer;
+
+	/* Executes one instruction whose opcode and operand have already been fetched */
+	using OpHandler = void (*)(CPU& cpu, s32& Cycles, Mem& memory, Word Operand);
+
+	/* Executes Op and the micro-ops fused with it (see DecodeCache), stopping early when
+	*	Cycles runs out like Execute would; @return the first micro-op it did not execute */
+	using FusedHandler = const MicroOp* (*)(CPU& cpu, s32& Cycles, Mem& memory, const MicroOp* Op);
 
 }
 
+/* Memory mapped device, gets the CPU reads and writes of the pages it is mapped to (see Mem::MapIo) */
+struct m6502::IoDevice
+{
+	virtual ~IoDevice() = default;
+	virtual Byte Read(Word Address) = 0;
+	virtual void Write(Word Address, Byte Value) = 0;
+
+	/* @return the Mem the device works on, if it is tied to one. A copy of that Mem
+	*	does not share the device, its pages go back to the RAM (see Mem::CopyFrom). */
+	virtual const Mem* BoundTo() const
+	{
+		return nullptr;
+	}
+};
+
 struct m6502::Mem
 {
 	static constexpr u32 MAX_MEM = 1024 * 64;
-	Byte Data[MAX_MEM];
+	static constexpr u32 PAGE_SIZE = 256;
+	static constexpr u32 NUM_PAGES = MAX_MEM / PAGE_SIZE;
+	static constexpr u32 PORT_BYTES = 2;	// $00 and $01, see MapPort
+	Byte Data[MAX_MEM];		// the RAM
+
+	/* Bumped on every write to the RAM of the page, lets decoded code notice self-modifying writes.
+	*	Writing through Data directly bypasses it, and so Initialise and snapshots too. */
+	u32 PageVersion[NUM_PAGES] = {};
+
+#if M6502_DIRTY_MAP
+	/* A bit per page and a bit per byte of the RAM, set by the same writes as PageVersion
+	*	until ClearDirty; tells what changed since then without comparing the RAM */
+	u64 DirtyPages[NUM_PAGES / 64] = {};
+	u64 DirtyBytes[MAX_MEM / 64] = {};
+#endif
+
+	/* Page table the CPU goes through (Read, Write). A page points straight at host
+	*	memory, its RAM in Data or a ROM image, or is nullptr and goes to its device.
+	*	All RAM by default, see MapRam, MapRom and MapIo. */
+	const Byte* ReadPages[NUM_PAGES] = {};
+	Byte* WritePages[NUM_PAGES] = {};
+	IoDevice* Devices[NUM_PAGES] = {};
+	IoDevice* Port = nullptr;	// gets the writes of $00 and $01 if set, see MapPort
+
+	/* Bumped whenever the page table changes (MapVersion) and per remapped page
+	*	(PageMapVersion), tell compiled code that a memory access it inlined may
+	*	have to go somewhere else now */
+	u32 MapVersion = 0;
+	u32 PageMapVersion[NUM_PAGES] = {};
+
+	/* Bumped on every read and write that goes to a device or the port, tells whether
+	*	state outside the RAM (a device's registers) may have changed */
+	mutable u32 DeviceAccesses = 0;
+
+	/* PageVersion of each page when Initialise last left it cleared */
+	u32 ClearedVersion[NUM_PAGES];
+
+	/* Unique per Mem object, tells a DecodeCache which memory it was filled from */
+	const u32 Id = NewId();
+
+	Mem()
+	{
+		MapRam(0, NUM_PAGES);
+		for (u32 Page = 0; Page < NUM_PAGES; Page++) {
+			ClearedVersion[Page] = PageVersion[Page] - 1;	// not cleared yet
+		}
+	}
+
+	Mem(const Mem& Other)
+	{
+		CopyFrom(Other);
+	}
+
+	Mem& operator=(const Mem& Other)
+	{
+		CopyFrom(Other);
+		return *this;
+	}
 
-	void Initialise()
+	/* Clears the RAM, the page table stays as it is. Only the pages written since
+	*	the last Initialise are cleared again (see ClearedVersion), the others still are. */
+	void Initialise();
+
+	/* Counts every byte of Page as written: bumps its version and marks it dirty */
+	void PageWritten(u32 Page);
+
+	/* @return true if a byte of Page was written since ClearDirty */
+	bool PageDirty(u32 Page) const
+	{
+#if M6502_DIRTY_MAP
+		return (DirtyPages[Page / 64] >> (Page % 64)) & 1;
+#else
+		return true;
+#endif
+	}
+
+	/* @return true if Address was written since ClearDirty */
+	bool ByteDirty(u32 Address) const
+	{
+#if M6502_DIRTY_MAP
+		return (DirtyBytes[Address / 64] >> (Address % 64)) & 1;
+#else
+		return true;
+#endif
+	}
+
+	/* @return true if a byte of [First, First + Count) was written since ClearDirty */
+	bool RangeDirty(u32 First, u32 Count) const;
+
+	/* @return the first page from Page on that is dirty, or NUM_PAGES */
+	u32 NextDirtyPage(u32 Page) const;
+
+	/* Forgets the writes so far, of every page or of Pages pages from FirstPage */
+	void ClearDirty(u32 FirstPage = 0, u32 Pages = NUM_PAGES);
+
+	/* Maps Pages pages from FirstPage back to the RAM */
+	void MapRam(u32 FirstPage, u32 Pages);
+
+	/* Maps Pages pages of Rom from FirstPage: reads come from Rom, writes go to the RAM
+	*	underneath like on the C64. Rom is not copied, it must outlive the mapping. */
+	void MapRom(u32 FirstPage, u32 Pages, const Byte* Rom);
+
+	/* Maps Pages pages from FirstPage to Device, it gets every read and write of them */
+	void MapIo(u32 FirstPage, u32 Pages, IoDevice* Device);
+
+	/* Sends the writes of $00 and $01 to Device (nullptr: back to the RAM), the rest of
+	*	page 0 stays RAM and reads are left alone: the 6510 on-chip port (see C64Banking) */
+	void MapPort(IoDevice* Device);
+
+	/* @return true if the CPU reads the RAM at Address */
+	bool ReadsRam(Word Address) const
 	{
-		for (u32 i = 0; i < MAX_MEM; i++) {
-			Data[i] = 0;
+		return ReadPages[Address / PAGE_SIZE] == &Data[Address / PAGE_SIZE * PAGE_SIZE];
+	}
+
+	/* @return true if the CPU writes the RAM at Address (RAM and ROM pages, not the port) */
+	bool WritesRam(Word Address) const
+	{
+		return WritePages[Address / PAGE_SIZE] == &Data[Address / PAGE_SIZE * PAGE_SIZE]
+			&& (Address >= PORT_BYTES || !Port);
+	}
+
+	/* @return true if the CPU reads and writes the RAM at Address */
+	bool IsRam(Word Address) const
+	{
+		return ReadsRam(Address) && WritesRam(Address);
+	}
+
+	/* CPU read of 1 byte, through the page table */
+	M6502_FORCE_INLINE Byte Read(Word Address) const
+	{
+		const u32 Page = Address / PAGE_SIZE;
+		if (const Byte* Host = ReadPages[Page])
+		{
+			return Host[Address % PAGE_SIZE];
 		}
+		return ReadDevice(Address);
 	}
 
-	/* read 1 byte */
+	/* CPU write of 1 byte, through the page table. Only writes to the RAM bump the
+	*	page version and mark it dirty, a device changes the RAM through Poke if at all. */
+	M6502_FORCE_INLINE void Write(Word Address, Byte Value)
+	{
+		const u32 Page = Address / PAGE_SIZE;
+		Byte* Host = WritePages[Page];
+		if (Host && (Address >= PORT_BYTES || !Port))
+		{
+			PageVersion[Page]++;
+			MarkDirty(Address);
+			Host[Address % PAGE_SIZE] = Value;
+			return;
+		}
+		WriteDevice(Address, Value);
+	}
+
+	/* read 1 byte of RAM */
 	Byte operator[](u32 Address) const
 	{
 		//assert here Address <  MAX_MEM
 		return Data[Address];
 	}
 
-	/* write 1 byte */
-	Byte& operator[](u32 Address)
+	/* 1 byte of RAM through a non-const Mem (see ByteRef), assigning it writes */
+	class ByteRef;
+	ByteRef operator[](u32 Address);
+
+	/* write 1 byte of RAM, the host side of Write: bumps the page version and marks it dirty */
+	void Poke(u32 Address, Byte Value)
 	{
 		//assert here Address <  MAX_MEM
-		return Data[Address];
+		PageVersion[Address / PAGE_SIZE]++;
+		MarkDirty(Address);
+		Data[Address] = Value;
+	}
+
+private:
+	static u32 NewId();
+
+	M6502_FORCE_INLINE void MarkDirty(u32 Address)
+	{
+#if M6502_DIRTY_MAP
+		DirtyPages[Address / PAGE_SIZE / 64] |= u64(1) << (Address / PAGE_SIZE % 64);
+		DirtyBytes[Address / 64] |= u64(1) << (Address % 64);
+#else
+		(void)Address;
+#endif
+	}
+
+	/* Points Page at Read, Write and Device, versions are only bumped if that changes anything */
+	void MapPage(u32 Page, const Byte* Read, Byte* Write, IoDevice* Device);
+
+	/* The I/O side of Read and Write, out of line so the RAM path stays small where it is inlined */
+	Byte ReadDevice(Word Address) const;
+	void WriteDevice(Word Address, Byte Value);
+
+	/* copies the contents and the page table, every page counts as written.
+	*	Pages on Other's RAM are moved to this RAM, ROM images and devices are shared,
+	*	except devices bound to another Mem (IoDevice::BoundTo): their pages are RAM
+	*	here, a port bound to another Mem is left out the same way. */
+	void CopyFrom(const Mem& Other);
+};
+
+/* What a non-const mem[Address] gives: reading it is a plain read of the RAM,
+*	only assigning it is a write (Poke), so reads leave decoded code and the dirty map alone */
+class m6502::Mem::ByteRef
+{
+public:
+	operator Byte() const
+	{
+		return Memory.Data[Address];
+	}
+
+	ByteRef& operator=(Byte Value)
+	{
+		Memory.Poke(Address, Value);
+		return *this;
+	}
+
+	ByteRef& operator=(const ByteRef& Other)
+	{
+		return *this = static_cast<Byte>(Other);
 	}
+
+private:
+	friend struct Mem;
+	ByteRef(Mem& memory, u32 Address) : Memory(memory), Address(Address) {}
+
+	Mem& Memory;
+	u32 Address;
+};
+
+inline m6502::Mem::ByteRef m6502::Mem::operator[](u32 Address)
+{
+	return ByteRef(*this, Address);
+}
+
+/* A decoded instruction, ready to run again without re-reading its bytes */
+struct m6502::MicroOp
+{
+	OpHandler Handler;	// nullptr when the opcode is not handled
+	Word Operand;
+	Byte Length;		// instruction size in bytes, opcode included
+	Byte Cycles;		// base cycles, see OpcodeTable
+	Byte Opcode;
+	FusedHandler Fused = nullptr;	// runs this op and the following ones as one, if set
 };
 
 struct m6502::StatusFlags
@@ -65,6 +358,31 @@ union PSUnion
 	m6502::StatusFlags Flags;
 };
 
+/* The status flags as the instructions use them, one byte (0 or 1) per flag,
+*	so setting one is a plain store instead of a read-modify-write of PS */
+struct m6502::HostFlags
+{
+	Byte C, Z, I, D, B, Unused, V, N;
+};
+
+/* What CPU::SkipIdleLoop remembers of the last loop it looked at */
+struct m6502::IdleLoop
+{
+	static constexpr u32 MAX_BYTES = 32;	// longest loop body looked at, jump back included
+	static constexpr Byte CHECK_EVERY = 16;	// backward jumps between two looks
+
+	Byte Countdown = CHECK_EVERY;	// at 1 the state is noted, at 0 it is compared
+	Word Start = 0;				// first instruction of the loop
+	Word End = 0;				// the branch or JMP back to Start
+	Byte A = 0, X = 0, Y = 0, SP = 0;	// state the last time the loop started
+	HostFlags Status = {};
+
+	u32 Bytes = 0;				// size of the decoded loop in Code, 0 if not decoded
+	u32 Starts = 0;				// bit per offset from Start where an instruction starts
+	bool Pure = false;			// no instruction in Code writes memory or uses the stack
+	Byte Code[MAX_BYTES];
+};
+
 struct m6502::CPU
 {
 
@@ -73,7 +391,22 @@ struct m6502::CPU
 
 	Byte A, X, Y;		// Accumulator, Index register X, Index register Y
 
-	PSUnion PS;
+	PSUnion PS;			// architectural view of the status, up to date outside of Execute
+
+	/* Status used while executing: Execute unpacks PS into it on entry (UnpackStatus)
+	*	and packs it back before returning (PackStatus), Interpret works on it only */
+	HostFlags Status;
+
+	/* Lazy flags: C and V are plain stores to Status, but N and Z are only recorded
+	*	as the result byte in FlagResult; FlagN/FlagZ work them out of it and
+	*	SyncFlags writes them to Status. */
+	static constexpr Byte FLAGS_SYNCED = 0;		// Status holds every flag
+	static constexpr Byte FLAGS_NZ = 1;			// N and Z come from FlagResult
+	Byte FlagKind = FLAGS_SYNCED;
+	Byte FlagResult = 0;
+
+	IdleLoop Idle;
+	u64 IdleCyclesSkipped = 0;	// cycles fast-forwarded by SkipIdleLoop since Reset
 
 	void Reset(Mem& memory, Word InitAddress = 0xFFFC)
 	{
@@ -81,31 +414,43 @@ struct m6502::CPU
 		SP = 0xFF;
 		PS.Flags.C = PS.Flags.Z = PS.Flags.I = PS.Flags.D = PS.Flags.B = PS.Flags.V = PS.Flags.N = 0;
 		A = X = Y = 0;
+		UnpackStatus();
+		Idle = IdleLoop();
+		IdleCyclesSkipped = 0;
 		memory.Initialise();
 	}
 
-	Byte FetchByte(s32& Cycles, const Mem& memory)
+	/* The bus helpers below do not use cycles: Execute charges every instruction
+	*	its base cycles from OpcodeTable once, handlers only add the penalties */
+
+	M6502_FORCE_INLINE Byte FetchByte(const Mem& memory)
 	{
-		Byte Data = memory[PC];
+		Byte Data = memory.Read(PC);
 		PC++;
-		Cycles--;
 		return Data;
 	}
 
 
 	// 6502 is little endian
-	Word FetchWord(s32& Cycles, const Mem& memory)
+	M6502_FORCE_INLINE Word FetchWord(const Mem& memory)
 	{
+		// both bytes in one host page: a single page table lookup
+		const Byte* Host = memory.ReadPages[PC / Mem::PAGE_SIZE];
+		const u32 Offset = PC % Mem::PAGE_SIZE;
+		if (Host && Offset != Mem::PAGE_SIZE - 1)
+		{
+			PC += 2;
+			return Host[Offset] | (Host[Offset + 1] << 8);
+		}
+
 		// read less significant byte
-		Word Data = memory[PC];
+		Word Data = memory.Read(PC);
 		PC++;
 
 		// read most significant byte
-		Data |= (memory[PC] << 8);
+		Data |= (memory.Read(PC) << 8);
 		PC++;
 
-		Cycles -= 2;
-
 		// if you want to handle endianness
 		// you would have to swap bytes here
 		// if(PLATFORM_BIG_ENDIAN)
@@ -114,34 +459,31 @@ struct m6502::CPU
 		return Data;
 	}
 
-	Byte ReadByte(s32& Cycles, Word Address, const Mem& memory)
+	M6502_FORCE_INLINE Byte ReadByte(Word Address, const Mem& memory)
 	{
-		Byte Data = memory[Address];
-		Cycles--;
+		Byte Data = memory.Read(Address);
 		return Data;
 	}
 
-	Word ReadWord(s32& Cycles, Word Address, const Mem& memory)
+	M6502_FORCE_INLINE Word ReadWord(Word Address, const Mem& memory)
 	{
-		Byte LowByte = ReadByte(Cycles, Address, memory);
-		Byte HighByte = ReadByte(Cycles, Address+1, memory);
+		Byte LowByte = ReadByte(Address, memory);
+		Byte HighByte = ReadByte(Address+1, memory);
 		Word Data = ((Word)HighByte << 8) | LowByte;
 		return Data;
 	}
 	
 	/* write 1 byte to memory */
-	void WriteByte(Byte Value, Word Address, s32& Cycles, Mem& memory)
+	M6502_FORCE_INLINE void WriteByte(Byte Value, Word Address, Mem& memory)
 	{
-		memory[Address] = Value;
-		Cycles--;
+		memory.Write(Address, Value);
 	}
 
 	/* write 1 word to memory*/
-	void WriteWord(Word Value, u32 Address, s32& Cycles, Mem& memory)
+	void WriteWord(Word Value, u32 Address, Mem& memory)
 	{
-		memory[Address] = Value & 0xFF;
-		memory[Address + 1] = (Value >> 8);
-		Cycles -= 2;
+		WriteByte(Value & 0xFF, static_cast<Word>(Address), memory);
+		WriteByte(Value >> 8, static_cast<Word>(Address + 1), memory);
 	}
 
 	/* @return the stack pointer as a full 16-bit address (in the first page)*/
@@ -151,38 +493,32 @@ struct m6502::CPU
 	}
 
 	/* Push the PC-1 onto the stack*/
-	void PushPCToStack(s32& Cycles, Mem& memory)
+	void PushPCToStack(Mem& memory)
 	{
-		WriteWord(PC, SPToAddress()-1, Cycles, memory);
+		WriteWord(PC, SPToAddress()-1, memory);
 		SP -= 2;
 	}
 
 	/* Pop a word from the stack*/
-	Word PopWordFromStack(s32& Cycles, Mem& memory)
+	Word PopWordFromStack(Mem& memory)
 	{
-		Word Value = ReadWord(Cycles, SPToAddress()+1, memory);
+		Word Value = ReadWord(SPToAddress()+1, memory);
 		SP += 2;
-		Cycles--;
 		return Value;
 	}
 
 	/* Pop a byte from the stack*/
-	Byte PopByteFromStack(s32& Cycles, Mem& memory)
+	Byte PopByteFromStack(Mem& memory)
 	{
-		Word StackAddress = SPToAddress() + 1;
-		Byte Value = ReadByte(Cycles, SPToAddress()+1, memory);
-		Cycles--;
+		Byte Value = ReadByte(SPToAddress()+1, memory);
 		SP++;
-		Cycles--;
 		return Value;
 	}
 
-	void PushByteOnTheStack(Byte Value, s32& Cycles, Mem& memory)
+	void PushByteOnTheStack(Byte Value, Mem& memory)
 	{
-		memory[SPToAddress()] = Value;
-		Cycles--;
+		WriteByte(Value, SPToAddress(), memory);
 		SP--;
-		Cycles--;
 	}
 
 
@@ -307,7 +643,14 @@ struct m6502::CPU
 		INS_ADC_INX =	0x61,
 		INS_ADC_INY =	0x71,
 		// SBC
-		INS_SBC_IM = 0xE9,
+		INS_SBC_IM =	0xE9,
+		INS_SBC_ZP =	0xE5,
+		INS_SBC_ZPX =	0xF5,
+		INS_SBC_ABS =	0xED,
+		INS_SBC_ABSX =	0xFD,
+		INS_SBC_ABSY =	0xF9,
+		INS_SBC_INX =	0xE1,
+		INS_SBC_INY =	0xF1,
 		// Compare
 		INS_CMP_IM =	0xC9,
 		INS_CMP_ZP =	0xC5,
@@ -331,63 +674,211 @@ struct m6502::CPU
 
 		
 	
-	Word LoadPrg(Byte* Program, u32 nBytes, Mem& memory);
+	/* Copies a .prg image (load address then the bytes) into the RAM at its load address,
+	*	the bytes that would wrap past $FFFF are dropped. @return the load address */
+	Word LoadPrg(const Byte* Program, u32 nBytes, Mem& memory);
+
+	/* Maps the .prg file (see RomImage::Open) and loads it like LoadPrg.
+	*	@return false, loading nothing, if it cannot be opened, has no bytes after
+	*	its load address or would wrap past $FFFF */
+	bool LoadPrgFile(const char* Path, Mem& memory, Word& LoadAddress);
 
 	/** Sets the correct Process status after a load register instruction
 	*	- LDA, LDX, LDY
 	*	@Register The A, X or Y Register */
 	void LoadRegisterSetStatus(Byte Register)
 	{
-		PS.Flags.Z = (Register == 0);
-		PS.Flags.N = (Register & 0b10000000) > 0;
+#if M6502_LAZY_FLAGS
+		FlagKind = FLAGS_NZ;
+		FlagResult = Register;
+#else
+		Status.Z = (Register == 0);
+		Status.N = Register >> 7;
+#endif
 	}
 
 	void SetADCFlags(Word Value) 
 	{
-		PS.Flags.N = (Value & 0b0000000010000000) > 0;
-		PS.Flags.Z = (Value & 0x00FF ) == 0;
-		PS.Flags.C = (Value > 0xFF) ;
-		PS.Flags.V = PS.Flags.N ^ PS.Flags.C;
-
+		Status.C = (Value > 0xFF);
+		Status.V = ((Value >> 7) ^ (Value >> 8)) & 1;	// N ^ C
+#if M6502_LAZY_FLAGS
+		FlagKind = FLAGS_NZ;
+		FlagResult = static_cast<Byte>(Value);
+#else
+		Status.N = (Value & 0b0000000010000000) > 0;
+		Status.Z = (Value & 0x00FF ) == 0;
+#endif
 	}
 
 	void SetCMPFlags(Byte Value)
 	{
-		PS.Flags.N = (Value & 0b10000000) > 0;
-		PS.Flags.Z = Value == 0;
-		PS.Flags.C = (Value & 0b10000000) == 0;
+		Status.C = (Value >> 7) ^ 1;
+#if M6502_LAZY_FLAGS
+		FlagKind = FLAGS_NZ;
+		FlagResult = Value;
+#else
+		Status.N = Value >> 7;
+		Status.Z = Value == 0;
+#endif
+	}
+
+	bool FlagZ() const
+	{
+		return (FlagKind == FLAGS_SYNCED) ? Status.Z : FlagResult == 0;
+	}
 
+	bool FlagN() const
+	{
+		return (FlagKind == FLAGS_SYNCED) ? Status.N : FlagResult >> 7;
 	}
+
+	/* Writes the pending lazy flags to Status */
+	void SyncFlags()
+	{
+		if (FlagKind != FLAGS_SYNCED)
+		{
+			Status.N = FlagResult >> 7;
+			Status.Z = FlagResult == 0;
+			FlagKind = FLAGS_SYNCED;
+		}
+	}
+
+	/* @return Status as the architectural status byte (PHP, PS) */
+	Byte PackFlags()
+	{
+		SyncFlags();
+		return static_cast<Byte>(Status.C | (Status.Z << 1) | (Status.I << 2) | (Status.D << 3)
+			| (Status.B << 4) | (Status.Unused << 5) | (Status.V << 6) | (Status.N << 7));
+	}
+
+	/* Sets Status from an architectural status byte (PLP, PS) */
+	void UnpackFlags(Byte Value)
+	{
+		Status.C = Value & 1;
+		Status.Z = (Value >> 1) & 1;
+		Status.I = (Value >> 2) & 1;
+		Status.D = (Value >> 3) & 1;
+		Status.B = (Value >> 4) & 1;
+		Status.Unused = (Value >> 5) & 1;
+		Status.V = (Value >> 6) & 1;
+		Status.N = Value >> 7;
+		FlagKind = FLAGS_SYNCED;
+	}
+
+	void PackStatus() { PS.Reg = PackFlags(); }
+	void UnpackStatus() { UnpackFlags(PS.Reg); }
 	
 	/** @return the number of cycles that were used */
 	s32 Execute(s32 Cycles, Mem& memory);
 
-	/* Addressing mode - Zero Page */
-	Word AddrZeroPage(s32& Cycles, const Mem& memory);
+	/** Same as Execute, but leaves PS alone: runs on Status as it is and
+	*	does not pack it back. For the engines that already unpacked it.
+	*	@return the number of cycles that were used */
+	s32 Interpret(s32 Cycles, Mem& memory);
 
-	/* Addressing mode - Zero Page with offset */
-	Word AddrZeroPageOffset(s32& Cycles, const Mem& memory, const Byte Offset);
+	/** Same as Execute, but runs straight-line code from the pre-decoded blocks in Cache
+	*	@return the number of cycles that were used */
+	s32 Execute(s32 Cycles, Mem& memory, DecodeCache& Cache);
+
+	/** Same as Execute, but runs hot code compiled to native code by jit
+	*	@return the number of cycles that were used */
+	s32 Execute(s32 Cycles, Mem& memory, Jit& jit);
+
+	/** Decodes the instruction at Address without executing it or using cycles */
+	static MicroOp Decode(Word Address, const Mem& memory);
+
+	/* The addressing modes below take the operand already fetched after the opcode,
+	*	the ones with Cycles charge the page-cross penalty */
 
-	/* Addressing mode - Absolute */
-	Word AddrAbsolute(s32& Cycles, const Mem& memory);
+	/* Addressing mode - Zero Page with offset */
+	Word AddrZeroPageOffset(Word Operand, const Byte Offset)
+	{
+		Byte ZeroPageAddr = static_cast<Byte>(Operand);
+		ZeroPageAddr += Offset;
+		return ZeroPageAddr;
+	}
 
 	/* Addressing mode - Absolute with offset */
-	Word AddrAbsoluteOffset(s32& Cycles, const Mem& memory, const Byte Offset);
+	Word AddrAbsoluteOffset(s32& Cycles, Word Operand, const Byte Offset)
+	{
+		Word AbsAddr = Operand;
+		Word AbsAddrX = AbsAddr + Offset;
+		if ((AbsAddrX & 0x00FF) < (AbsAddr & 0x00FF))
+		{
+			Cycles--;
+		}
+		return AbsAddrX;
+	}
 
 	/* Addressing mode - Indirect X indexing offset */
-	Word AddrIndirectX(s32& Cycles, const Mem& memory);
+	Word AddrIndirectX(const Mem& memory, Word Operand)
+	{
+		Byte ZPAddress = static_cast<Byte>(Operand);
+		Byte ZPAddressX = ZPAddress + X;
+		Word EffectiveAddress = ReadWord(ZPAddressX, memory);
+		return EffectiveAddress;
+	}
 
 	/* Addressing mode - Indirect Y indexing offset */
-	Word AddrIndirectY(s32& Cycles, const Mem& memory);
+	Word AddrIndirectY(s32& Cycles, const Mem& memory, Word Operand)
+	{
+		Word ZPAddress = Operand;
+		Word EffectiveAddress = ReadWord(ZPAddress, memory);
+		Word EffectiveAddressY = EffectiveAddress + Y;
+		if ((EffectiveAddressY & 0x00FF) < (EffectiveAddress & 0x00FF))
+		{
+			Cycles--;
+		}
+		return EffectiveAddressY;
+	}
 
-	/* Addressing mode - Indirect Y indexing offset for store Operations (TODO: check why is that) */
-	Word AddrIndirectYStore(s32& Cycles, const Mem& memory);
+	/* Addressing mode - Indirect Y indexing offset for store operations, which always take the extra cycle */
+	Word AddrIndirectYStore(const Mem& memory, Word Operand)
+	{
+		Word ZPAddress = Operand;
+		Word EffectiveAddress = ReadWord(ZPAddress, memory);
+		Word EffectiveAddressY = EffectiveAddress + Y;
+		return EffectiveAddressY;
+	}
+
+	/* Addressing mode - Absolute with offset for store operations, which always take the extra cycle */
+	Word AddrAbsoluteOffsetStore(Word Operand, const Byte Offset)
+	{
+		Word AbsAddr = Operand;
+		Word AbsAddrX = AbsAddr + Offset;
+		return AbsAddrX;
+	}
 
-	/* Addressing mode - Absolute with X offset for store operations (TODO: check why is that) */
-	Word AddrAbsoluteOffsetStore(s32& Cycles, const Mem& memory, const Byte Offset);
+	/* Branches on a given condition, Operand is the signed offset */
+	void BranchCondition(s32& Cycles, Mem& memory, Word Operand, bool condition)
+	{
+		Byte Offset = static_cast<Byte>(Operand);
+		if (condition) {
+			const Word BranchAddress = PC - 2;
+			Word Address = PC + static_cast<sByte>(Offset);
+			if ((Address & 0xFF00) != (PC & 0xFF00))
+			{
+				Cycles -= 2;
+			}
+			PC = Address;
+			Cycles--;
+#if M6502_IDLE_SKIP
+			if (Address <= BranchAddress && --Idle.Countdown <= 1)
+			{
+				SkipIdleLoop(Cycles, memory, BranchAddress);
+			}
+#endif
+		}
+	}
 
-	/* Branches on a given condition*/
-	void BranchCondition(s32& Cycles, const Mem& memory, bool condition);
+	/** Called after a jump back from JumpAddress to PC. If the loop in between
+	*	only burns cycles, takes the cycles of as many whole iterations as
+	*	Cycles allows at once and adds them to IdleCyclesSkipped. The state
+	*	is left exactly as running those iterations would leave it.
+	*	- a loop that comes back to the same registers and flags without
+	*	  writing memory (JMP *, polling a location) is skipped up to the budget
+	*	- DEX/DEY/INX/INY + BNE delay loops are skipped up to their last round */
+	void SkipIdleLoop(s32& Cycles, Mem& memory, Word JumpAddress);
 
 
 
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "main_6502.h"
+
+/* Compile-time description of the 256 opcodes, generated from the INS_* constants
+*	listed in M6502_HANDLED_OPCODES. Cycle counts are the NMOS 6502 ones the tests expect. */
+namespace m6502
+{
+	enum class AddressingMode : Byte
+	{
+		Implied,
+		Immediate,
+		ZeroPage,
+		ZeroPageX,
+		ZeroPageY,
+		Absolute,
+		AbsoluteX,
+		AbsoluteY,
+		Indirect,
+		IndirectX,
+		IndirectY,
+		Relative
+	};
+
+	struct OpcodeInfo
+	{
+		const char* Mnemonic;		// "???" when the opcode is not handled
+		AddressingMode Mode;
+		Byte Length;				// instruction size in bytes, opcode included
+		Byte Cycles;				// base cycles, charged once when the instruction runs
+		Byte PageCrossPenalty;		// extra cycles when indexing or a taken branch crosses a page
+		Byte BranchPenalty;			// extra cycles when a branch is taken
+		bool Handled;
+	};
+
+	struct OpcodeTableType
+	{
+		OpcodeInfo Info[256];
+
+		constexpr const OpcodeInfo& operator[](Byte Opcode) const { return Info[Opcode]; }
+	};
+}
+
+/* Expands X(Name, Mnemonic, Mode, Length, Cycles, PageCrossPenalty, BranchPenalty) for every
+*	handled opcode: CPU::INS_<Name> runs Ops::Op_<Name> */
+#define M6502_HANDLED_OPCODES(X) \
+	X(LDA_IM, "LDA", Immediate, 2, 2, 0, 0) \
+	X(LDX_IM, "LDX", Immediate, 2, 2, 0, 0) \
+	X(LDY_IM, "LDY", Immediate, 2, 2, 0, 0) \
+	X(LDA_ZP, "LDA", ZeroPage, 2, 3, 0, 0) \
+	X(LDX_ZP, "LDX", ZeroPage, 2, 3, 0, 0) \
+	X(LDY_ZP, "LDY", ZeroPage, 2, 3, 0, 0) \
+	X(LDA_ZPX, "LDA", ZeroPageX, 2, 4, 0, 0) \
+	X(LDX_ZPY, "LDX", ZeroPageY, 2, 4, 0, 0) \
+	X(LDY_ZPX, "LDY", ZeroPageX, 2, 4, 0, 0) \
+	X(LDA_ABS, "LDA", Absolute, 3, 4, 0, 0) \
+	X(LDX_ABS, "LDX", Absolute, 3, 4, 0, 0) \
+	X(LDY_ABS, "LDY", Absolute, 3, 4, 0, 0) \
+	X(LDA_ABSX, "LDA", AbsoluteX, 3, 4, 1, 0) \
+	X(LDA_ABSY, "LDA", AbsoluteY, 3, 4, 1, 0) \
+	X(LDX_ABSY, "LDX", AbsoluteY, 3, 4, 1, 0) \
+	X(LDY_ABSX, "LDY", AbsoluteX, 3, 4, 1, 0) \
+	X(LDA_INDX, "LDA", IndirectX, 2, 6, 0, 0) \
+	X(LDA_INDY, "LDA", IndirectY, 2, 5, 1, 0) \
+	X(STA_ZP, "STA", ZeroPage, 2, 3, 0, 0) \
+	X(STA_ZPX, "STA", ZeroPageX, 2, 4, 0, 0) \
+	X(STA_ABS, "STA", Absolute, 3, 4, 0, 0) \
+	X(STA_ABSX, "STA", AbsoluteX, 3, 5, 0, 0) \
+	X(STA_ABSY, "STA", AbsoluteY, 3, 5, 0, 0) \
+	X(STX_ZP, "STX", ZeroPage, 2, 3, 0, 0) \
+	X(STX_ZPY, "STX", ZeroPageY, 2, 4, 0, 0) \
+	X(STY_ZP, "STY", ZeroPage, 2, 3, 0, 0) \
+	X(STY_ZPX, "STY", ZeroPageX, 2, 4, 0, 0) \
+	X(STX_ABS, "STX", Absolute, 3, 4, 0, 0) \
+	X(STY_ABS, "STY", Absolute, 3, 4, 0, 0) \
+	X(STA_INDX, "STA", IndirectX, 2, 6, 0, 0) \
+	X(STA_INDY, "STA", IndirectY, 2, 6, 0, 0) \
+	X(TSX, "TSX", Implied, 1, 2, 0, 0) \
+	X(TXS, "TXS", Implied, 1, 2, 0, 0) \
+	X(TYA, "TYA", Implied, 1, 2, 0, 0) \
+	X(TAY, "TAY", Implied, 1, 2, 0, 0) \
+	X(TXA, "TXA", Implied, 1, 2, 0, 0) \
+	X(TAX, "TAX", Implied, 1, 2, 0, 0) \
+	X(PHA, "PHA", Implied, 1, 3, 0, 0) \
+	X(PHP, "PHP", Implied, 1, 3, 0, 0) \
+	X(PLA, "PLA", Implied, 1, 4, 0, 0) \
+	X(PLP, "PLP", Implied, 1, 4, 0, 0) \
+	X(INX, "INX", Implied, 1, 2, 0, 0) \
+	X(INY, "INY", Implied, 1, 2, 0, 0) \
+	X(DEX, "DEX", Implied, 1, 2, 0, 0) \
+	X(DEY, "DEY", Implied, 1, 2, 0, 0) \
+	X(INC_ABS, "INC", Absolute, 3, 6, 0, 0) \
+	X(INC_ABSX, "INC", AbsoluteX, 3, 7, 0, 0) \
+	X(INC_ZP, "INC", ZeroPage, 2, 5, 0, 0) \
+	X(INC_ZPX, "INC", ZeroPageX, 2, 6, 0, 0) \
+	X(DEC_ABS, "DEC", Absolute, 3, 6, 0, 0) \
+	X(DEC_ABSX, "DEC", AbsoluteX, 3, 7, 0, 0) \
+	X(DEC_ZP, "DEC", ZeroPage, 2, 5, 0, 0) \
+	X(DEC_ZPX, "DEC", ZeroPageX, 2, 6, 0, 0) \
+	X(AND_IM, "AND", Immediate, 2, 2, 0, 0) \
+	X(AND_ZP, "AND", ZeroPage, 2, 3, 0, 0) \
+	X(AND_ZPX, "AND", ZeroPageX, 2, 4, 0, 0) \
+	X(AND_ABS, "AND", Absolute, 3, 4, 0, 0) \
+	X(AND_ABSX, "AND", AbsoluteX, 3, 4, 1, 0) \
+	X(AND_ABSY, "AND", AbsoluteY, 3, 4, 1, 0) \
+	X(AND_INDX, "AND", IndirectX, 2, 6, 0, 0) \
+	X(AND_INDY, "AND", IndirectY, 2, 5, 1, 0) \
+	X(XOR_IM, "EOR", Immediate, 2, 2, 0, 0) \
+	X(XOR_ZP, "EOR", ZeroPage, 2, 3, 0, 0) \
+	X(XOR_ZPX, "EOR", ZeroPageX, 2, 4, 0, 0) \
+	X(XOR_ABS, "EOR", Absolute, 3, 4, 0, 0) \
+	X(XOR_ABSX, "EOR", AbsoluteX, 3, 4, 1, 0) \
+	X(XOR_ABSY, "EOR", AbsoluteY, 3, 4, 1, 0) \
+	X(XOR_INDX, "EOR", IndirectX, 2, 6, 0, 0) \
+	X(XOR_INDY, "EOR", IndirectY, 2, 5, 1, 0) \
+	X(OR_IM, "ORA", Immediate, 2, 2, 0, 0) \
+	X(OR_ZP, "ORA", ZeroPage, 2, 3, 0, 0) \
+	X(OR_ZPX, "ORA", ZeroPageX, 2, 4, 0, 0) \
+	X(OR_ABS, "ORA", Absolute, 3, 4, 0, 0) \
+	X(OR_ABSX, "ORA", AbsoluteX, 3, 4, 1, 0) \
+	X(OR_ABSY, "ORA", AbsoluteY, 3, 4, 1, 0) \
+	X(OR_INDX, "ORA", IndirectX, 2, 6, 0, 0) \
+	X(OR_INDY, "ORA", IndirectY, 2, 5, 1, 0) \
+	X(BIT_ZP, "BIT", ZeroPage, 2, 3, 0, 0) \
+	X(BIT_ABS, "BIT", Absolute, 3, 4, 0, 0) \
+	X(BEQ, "BEQ", Relative, 2, 2, 2, 1) \
+	X(BNE, "BNE", Relative, 2, 2, 2, 1) \
+	X(BPL, "BPL", Relative, 2, 2, 2, 1) \
+	X(BMI, "BMI", Relative, 2, 2, 2, 1) \
+	X(BVC, "BVC", Relative, 2, 2, 2, 1) \
+	X(BVS, "BVS", Relative, 2, 2, 2, 1) \
+	X(BCC, "BCC", Relative, 2, 2, 2, 1) \
+	X(BCS, "BCS", Relative, 2, 2, 2, 1) \
+	X(CLC, "CLC", Implied, 1, 2, 0, 0) \
+	X(SEC, "SEC", Implied, 1, 2, 0, 0) \
+	X(CLI, "CLI", Implied, 1, 2, 0, 0) \
+	X(SEI, "SEI", Implied, 1, 2, 0, 0) \
+	X(CLV, "CLV", Implied, 1, 2, 0, 0) \
+	X(CLD, "CLD", Implied, 1, 2, 0, 0) \
+	X(SED, "SED", Implied, 1, 2, 0, 0) \
+	X(NOP, "NOP", Implied, 1, 2, 0, 0) \
+	X(ADC_IM, "ADC", Immediate, 2, 2, 0, 0) \
+	X(ADC_ZP, "ADC", ZeroPage, 2, 3, 0, 0) \
+	X(ADC_ZPX, "ADC", ZeroPageX, 2, 4, 0, 0) \
+	X(ADC_ABS, "ADC", Absolute, 3, 4, 0, 0) \
+	X(ADC_ABSX, "ADC", AbsoluteX, 3, 4, 1, 0) \
+	X(ADC_ABSY, "ADC", AbsoluteY, 3, 4, 1, 0) \
+	X(ADC_INX, "ADC", IndirectX, 2, 6, 0, 0) \
+	X(ADC_INY, "ADC", IndirectY, 2, 5, 1, 0) \
+	X(SBC_IM, "SBC", Immediate, 2, 2, 0, 0) \
+	X(SBC_ZP, "SBC", ZeroPage, 2, 3, 0, 0) \
+	X(SBC_ZPX, "SBC", ZeroPageX, 2, 4, 0, 0) \
+	X(SBC_ABS, "SBC", Absolute, 3, 4, 0, 0) \
+	X(SBC_ABSX, "SBC", AbsoluteX, 3, 4, 1, 0) \
+	X(SBC_ABSY, "SBC", AbsoluteY, 3, 4, 1, 0) \
+	X(SBC_INX, "SBC", IndirectX, 2, 6, 0, 0) \
+	X(SBC_INY, "SBC", IndirectY, 2, 5, 1, 0) \
+	X(CMP_IM, "CMP", Immediate, 2, 2, 0, 0) \
+	X(CMP_ZP, "CMP", ZeroPage, 2, 3, 0, 0) \
+	X(CMP_ZPX, "CMP", ZeroPageX, 2, 4, 0, 0) \
+	X(CMP_ABS, "CMP", Absolute, 3, 4, 0, 0) \
+	X(CMP_ABSX, "CMP", AbsoluteX, 3, 4, 1, 0) \
+	X(CMP_ABSY, "CMP", AbsoluteY, 3, 4, 1, 0) \
+	X(CMP_INX, "CMP", IndirectX, 2, 6, 0, 0) \
+	X(CMP_INY, "CMP", IndirectY, 2, 5, 1, 0) \
+	X(CMX_IM, "CPX", Immediate, 2, 2, 0, 0) \
+	X(CMX_ZP, "CPX", ZeroPage, 2, 3, 0, 0) \
+	X(CMX_ABS, "CPX", Absolute, 3, 4, 0, 0) \
+	X(CMY_IM, "CPY", Immediate, 2, 2, 0, 0) \
+	X(CMY_ZP, "CPY", ZeroPage, 2, 3, 0, 0) \
+	X(CMY_ABS, "CPY", Absolute, 3, 4, 0, 0) \
+	X(JSR, "JSR", Absolute, 3, 6, 0, 0) \
+	X(RTS, "RTS", Implied, 1, 6, 0, 0) \
+	X(JMP_ABS, "JMP", Absolute, 3, 3, 0, 0) \
+	X(JMP_IND, "JMP", Indirect, 3, 5, 0, 0)
+
+namespace m6502
+{
+	constexpr OpcodeTableType MakeOpcodeTable()
+	{
+		OpcodeTableType Table = {};
+		for (u32 Opcode = 0; Opcode < 256; Opcode++)
+		{
+			Table.Info[Opcode] = { "???", AddressingMode::Implied, 1, 0, 0, 0, false };
+		}
+#define M6502_DESCRIBE_OPCODE(Name, Mnemonic, Mode, Length, Cycles, PageCross, Branch) \
+		Table.Info[CPU::INS_##Name] = { Mnemonic, AddressingMode::Mode, Length, Cycles, PageCross, Branch, true };
+		M6502_HANDLED_OPCODES(M6502_DESCRIBE_OPCODE)
+#undef M6502_DESCRIBE_OPCODE
+		return Table;
+	}
+
+	/* OpcodeTable[Opcode] describes the opcode */
+	constexpr OpcodeTableType OpcodeTable = MakeOpcodeTable();
+}
@@ -0,0 +1,527 @@
+#pragma once
+
+#include "main_6502.h"
+#include "opcode_info_6502.h"
+
+/* Instruction handlers, shared by the interpreter cores and by translated code.
+*	The opcode and its operand have already been fetched, PC points to the next instruction
+*	and the base cycles of OpcodeTable are paid: handlers only charge the penalties.
+*	Loads, ALU operations, stores and read-modify-write instructions are instantiated from
+*	an addressing mode and an operation, so every opcode is a specialised function. */
+namespace m6502
+{
+namespace Ops
+{
+	/* Addressing modes: Address returns the effective address of the operand */
+
+	struct Immediate {};
+
+	struct ZeroPage
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return Operand; }
+	};
+
+	struct ZeroPageX
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrZeroPageOffset(Operand, cpu.X); }
+	};
+
+	struct ZeroPageY
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrZeroPageOffset(Operand, cpu.Y); }
+	};
+
+	struct Absolute
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return Operand; }
+	};
+
+	struct AbsoluteX
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrAbsoluteOffset(Cycles, Operand, cpu.X); }
+	};
+
+	struct AbsoluteY
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrAbsoluteOffset(Cycles, Operand, cpu.Y); }
+	};
+
+	struct IndirectX
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrIndirectX(memory, Operand); }
+	};
+
+	struct IndirectY
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrIndirectY(Cycles, memory, Operand); }
+	};
+
+	/* Store and read-modify-write variants always pay the indexing cycle */
+
+	struct AbsoluteXStore
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrAbsoluteOffsetStore(Operand, cpu.X); }
+	};
+
+	struct AbsoluteYStore
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrAbsoluteOffsetStore(Operand, cpu.Y); }
+	};
+
+	struct IndirectYStore
+	{
+		static Word Address(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand) { return cpu.AddrIndirectYStore(memory, Operand); }
+	};
+
+	/* @return the value an instruction in addressing mode Mode works on */
+	template <typename Mode>
+	inline Byte ReadOperand(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand)
+	{
+		Word Address = Mode::Address(cpu, Cycles, memory, Operand);
+		return cpu.ReadByte(Address, memory);
+	}
+
+	template <>
+	inline Byte ReadOperand<Immediate>(CPU& cpu, s32& Cycles, const Mem& memory, Word Operand)
+	{
+		return static_cast<Byte>(Operand);
+	}
+
+	/* Operations on a value read from memory */
+
+	template <Byte CPU::*Register>
+	struct Load
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			cpu.*Register = Value;
+			cpu.LoadRegisterSetStatus(Value);
+		}
+	};
+
+	struct And
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			cpu.A = (cpu.A & Value);
+			cpu.LoadRegisterSetStatus(cpu.A);
+		}
+	};
+
+	struct Eor
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			cpu.A = (cpu.A ^ Value);
+			cpu.LoadRegisterSetStatus(cpu.A);
+		}
+	};
+
+	struct Ora
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			cpu.A = (cpu.A | Value);
+			cpu.LoadRegisterSetStatus(cpu.A);
+		}
+	};
+
+	struct Adc
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			Word Result =
+				static_cast<Word>(cpu.A) +
+				static_cast<Word>(Value) +
+				static_cast<Word>(0x01 * cpu.Status.C);
+			cpu.SetADCFlags(Result);
+			cpu.A = static_cast<Byte>(Result & 0x00FF);
+		}
+	};
+
+	/* A - M - (1 - C) is A + ~M + C */
+	struct Sbc
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			Adc::Apply(cpu, static_cast<Byte>(~Value));
+		}
+	};
+
+	template <Byte CPU::*Register>
+	struct Compare
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			Byte Result = cpu.*Register - Value;
+			cpu.SetCMPFlags(Result);
+		}
+	};
+
+	struct Bit
+	{
+		static void Apply(CPU& cpu, Byte Value)
+		{
+			Byte Result = (cpu.A & Value);
+			cpu.FlagKind = CPU::FLAGS_SYNCED;
+			cpu.Status.Z = (Result == 0x00);
+			cpu.Status.N = Value >> 7;
+			cpu.Status.V = (Value >> 6) & 1;
+		}
+	};
+
+	/* Operations that modify a byte of memory in place */
+
+	struct Increment
+	{
+		static Byte Apply(Byte Value) { return Value + 1; }
+	};
+
+	struct Decrement
+	{
+		static Byte Apply(Byte Value) { return Value - 1; }
+	};
+
+	/* Instruction shapes */
+
+	template <typename Mode, typename Operation>
+	inline void Read(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Operation::Apply(cpu, ReadOperand<Mode>(cpu, Cycles, memory, Operand));
+	}
+
+	template <typename Mode, Byte CPU::*Register>
+	inline void Store(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Word Address = Mode::Address(cpu, Cycles, memory, Operand);
+		cpu.WriteByte(cpu.*Register, Address, memory);
+	}
+
+	template <typename Mode, typename Operation>
+	inline void Modify(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Word Address = Mode::Address(cpu, Cycles, memory, Operand);
+		Byte Value = Operation::Apply(cpu.ReadByte(Address, memory));
+		cpu.WriteByte(Value, Address, memory);
+		cpu.LoadRegisterSetStatus(Value);
+	}
+
+	using Lda = Load<&CPU::A>;
+	using Ldx = Load<&CPU::X>;
+	using Ldy = Load<&CPU::Y>;
+	using Cmp = Compare<&CPU::A>;
+	using Cpx = Compare<&CPU::X>;
+	using Cpy = Compare<&CPU::Y>;
+
+	constexpr OpHandler Op_LDA_IM = Read<Immediate, Lda>;
+	constexpr OpHandler Op_LDA_ZP = Read<ZeroPage, Lda>;
+	constexpr OpHandler Op_LDA_ZPX = Read<ZeroPageX, Lda>;
+	constexpr OpHandler Op_LDA_ABS = Read<Absolute, Lda>;
+	constexpr OpHandler Op_LDA_ABSX = Read<AbsoluteX, Lda>;
+	constexpr OpHandler Op_LDA_ABSY = Read<AbsoluteY, Lda>;
+	constexpr OpHandler Op_LDA_INDX = Read<IndirectX, Lda>;
+	constexpr OpHandler Op_LDA_INDY = Read<IndirectY, Lda>;
+
+	constexpr OpHandler Op_LDX_IM = Read<Immediate, Ldx>;
+	constexpr OpHandler Op_LDX_ZP = Read<ZeroPage, Ldx>;
+	constexpr OpHandler Op_LDX_ZPY = Read<ZeroPageY, Ldx>;
+	constexpr OpHandler Op_LDX_ABS = Read<Absolute, Ldx>;
+	constexpr OpHandler Op_LDX_ABSY = Read<AbsoluteY, Ldx>;
+
+	constexpr OpHandler Op_LDY_IM = Read<Immediate, Ldy>;
+	constexpr OpHandler Op_LDY_ZP = Read<ZeroPage, Ldy>;
+	constexpr OpHandler Op_LDY_ZPX = Read<ZeroPageX, Ldy>;
+	constexpr OpHandler Op_LDY_ABS = Read<Absolute, Ldy>;
+	constexpr OpHandler Op_LDY_ABSX = Read<AbsoluteX, Ldy>;
+
+	constexpr OpHandler Op_STA_ZP = Store<ZeroPage, &CPU::A>;
+	constexpr OpHandler Op_STA_ZPX = Store<ZeroPageX, &CPU::A>;
+	constexpr OpHandler Op_STA_ABS = Store<Absolute, &CPU::A>;
+	constexpr OpHandler Op_STA_ABSX = Store<AbsoluteXStore, &CPU::A>;
+	constexpr OpHandler Op_STA_ABSY = Store<AbsoluteYStore, &CPU::A>;
+	constexpr OpHandler Op_STA_INDX = Store<IndirectX, &CPU::A>;
+	constexpr OpHandler Op_STA_INDY = Store<IndirectYStore, &CPU::A>;
+	constexpr OpHandler Op_STX_ZP = Store<ZeroPage, &CPU::X>;
+	constexpr OpHandler Op_STX_ZPY = Store<ZeroPageY, &CPU::X>;
+	constexpr OpHandler Op_STX_ABS = Store<Absolute, &CPU::X>;
+	constexpr OpHandler Op_STY_ZP = Store<ZeroPage, &CPU::Y>;
+	constexpr OpHandler Op_STY_ZPX = Store<ZeroPageX, &CPU::Y>;
+	constexpr OpHandler Op_STY_ABS = Store<Absolute, &CPU::Y>;
+
+	constexpr OpHandler Op_INC_ZP = Modify<ZeroPage, Increment>;
+	constexpr OpHandler Op_INC_ZPX = Modify<ZeroPageX, Increment>;
+	constexpr OpHandler Op_INC_ABS = Modify<Absolute, Increment>;
+	constexpr OpHandler Op_INC_ABSX = Modify<AbsoluteXStore, Increment>;
+	constexpr OpHandler Op_DEC_ZP = Modify<ZeroPage, Decrement>;
+	constexpr OpHandler Op_DEC_ZPX = Modify<ZeroPageX, Decrement>;
+	constexpr OpHandler Op_DEC_ABS = Modify<Absolute, Decrement>;
+	constexpr OpHandler Op_DEC_ABSX = Modify<AbsoluteXStore, Decrement>;
+
+	constexpr OpHandler Op_AND_IM = Read<Immediate, And>;
+	constexpr OpHandler Op_AND_ZP = Read<ZeroPage, And>;
+	constexpr OpHandler Op_AND_ZPX = Read<ZeroPageX, And>;
+	constexpr OpHandler Op_AND_ABS = Read<Absolute, And>;
+	constexpr OpHandler Op_AND_ABSX = Read<AbsoluteX, And>;
+	constexpr OpHandler Op_AND_ABSY = Read<AbsoluteY, And>;
+	constexpr OpHandler Op_AND_INDX = Read<IndirectX, And>;
+	constexpr OpHandler Op_AND_INDY = Read<IndirectY, And>;
+
+	constexpr OpHandler Op_XOR_IM = Read<Immediate, Eor>;
+	constexpr OpHandler Op_XOR_ZP = Read<ZeroPage, Eor>;
+	constexpr OpHandler Op_XOR_ZPX = Read<ZeroPageX, Eor>;
+	constexpr OpHandler Op_XOR_ABS = Read<Absolute, Eor>;
+	constexpr OpHandler Op_XOR_ABSX = Read<AbsoluteX, Eor>;
+	constexpr OpHandler Op_XOR_ABSY = Read<AbsoluteY, Eor>;
+	constexpr OpHandler Op_XOR_INDX = Read<IndirectX, Eor>;
+	constexpr OpHandler Op_XOR_INDY = Read<IndirectY, Eor>;
+
+	constexpr OpHandler Op_OR_IM = Read<Immediate, Ora>;
+	constexpr OpHandler Op_OR_ZP = Read<ZeroPage, Ora>;
+	constexpr OpHandler Op_OR_ZPX = Read<ZeroPageX, Ora>;
+	constexpr OpHandler Op_OR_ABS = Read<Absolute, Ora>;
+	constexpr OpHandler Op_OR_ABSX = Read<AbsoluteX, Ora>;
+	constexpr OpHandler Op_OR_ABSY = Read<AbsoluteY, Ora>;
+	constexpr OpHandler Op_OR_INDX = Read<IndirectX, Ora>;
+	constexpr OpHandler Op_OR_INDY = Read<IndirectY, Ora>;
+
+	constexpr OpHandler Op_BIT_ZP = Read<ZeroPage, Bit>;
+	constexpr OpHandler Op_BIT_ABS = Read<Absolute, Bit>;
+
+	constexpr OpHandler Op_ADC_IM = Read<Immediate, Adc>;
+	constexpr OpHandler Op_ADC_ZP = Read<ZeroPage, Adc>;
+	constexpr OpHandler Op_ADC_ZPX = Read<ZeroPageX, Adc>;
+	constexpr OpHandler Op_ADC_ABS = Read<Absolute, Adc>;
+	constexpr OpHandler Op_ADC_ABSX = Read<AbsoluteX, Adc>;
+	constexpr OpHandler Op_ADC_ABSY = Read<AbsoluteY, Adc>;
+	constexpr OpHandler Op_ADC_INX = Read<IndirectX, Adc>;
+	constexpr OpHandler Op_ADC_INY = Read<IndirectY, Adc>;
+
+	constexpr OpHandler Op_SBC_IM = Read<Immediate, Sbc>;
+	constexpr OpHandler Op_SBC_ZP = Read<ZeroPage, Sbc>;
+	constexpr OpHandler Op_SBC_ZPX = Read<ZeroPageX, Sbc>;
+	constexpr OpHandler Op_SBC_ABS = Read<Absolute, Sbc>;
+	constexpr OpHandler Op_SBC_ABSX = Read<AbsoluteX, Sbc>;
+	constexpr OpHandler Op_SBC_ABSY = Read<AbsoluteY, Sbc>;
+	constexpr OpHandler Op_SBC_INX = Read<IndirectX, Sbc>;
+	constexpr OpHandler Op_SBC_INY = Read<IndirectY, Sbc>;
+
+	constexpr OpHandler Op_CMP_IM = Read<Immediate, Cmp>;
+	constexpr OpHandler Op_CMP_ZP = Read<ZeroPage, Cmp>;
+	constexpr OpHandler Op_CMP_ZPX = Read<ZeroPageX, Cmp>;
+	constexpr OpHandler Op_CMP_ABS = Read<Absolute, Cmp>;
+	constexpr OpHandler Op_CMP_ABSX = Read<AbsoluteX, Cmp>;
+	constexpr OpHandler Op_CMP_ABSY = Read<AbsoluteY, Cmp>;
+	constexpr OpHandler Op_CMP_INX = Read<IndirectX, Cmp>;
+	constexpr OpHandler Op_CMP_INY = Read<IndirectY, Cmp>;
+	constexpr OpHandler Op_CMX_IM = Read<Immediate, Cpx>;
+	constexpr OpHandler Op_CMX_ZP = Read<ZeroPage, Cpx>;
+	constexpr OpHandler Op_CMX_ABS = Read<Absolute, Cpx>;
+	constexpr OpHandler Op_CMY_IM = Read<Immediate, Cpy>;
+	constexpr OpHandler Op_CMY_ZP = Read<ZeroPage, Cpy>;
+	constexpr OpHandler Op_CMY_ABS = Read<Absolute, Cpy>;
+
+	inline void Op_TSX(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.X = cpu.SP;
+		cpu.LoadRegisterSetStatus(cpu.X);
+	}
+
+	inline void Op_TXS(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.SP = cpu.X;
+		cpu.LoadRegisterSetStatus(cpu.SP);
+	}
+
+	inline void Op_TYA(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.A = cpu.Y;
+		cpu.LoadRegisterSetStatus(cpu.A);
+	}
+
+	inline void Op_TAY(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Y = cpu.A;
+		cpu.LoadRegisterSetStatus(cpu.Y);
+	}
+
+	inline void Op_TXA(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.A = cpu.X;
+		cpu.LoadRegisterSetStatus(cpu.A);
+	}
+
+	inline void Op_TAX(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.X = cpu.A;
+		cpu.LoadRegisterSetStatus(cpu.X);
+	}
+
+	inline void Op_PHA(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.PushByteOnTheStack(cpu.A, memory);
+	}
+
+	inline void Op_PHP(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.PushByteOnTheStack(cpu.PackFlags(), memory);
+	}
+
+	inline void Op_PLA(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.A = cpu.PopByteFromStack(memory);
+		cpu.LoadRegisterSetStatus(cpu.A);
+	}
+
+	inline void Op_PLP(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.UnpackFlags(cpu.PopByteFromStack(memory));
+	}
+
+	inline void Op_INX(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.X += 1;
+		cpu.LoadRegisterSetStatus(cpu.X);
+	}
+
+	inline void Op_INY(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Y += 1;
+		cpu.LoadRegisterSetStatus(cpu.Y);
+	}
+
+	inline void Op_DEX(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.X -= 1;
+		cpu.LoadRegisterSetStatus(cpu.X);
+	}
+
+	inline void Op_DEY(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Y -= 1;
+		cpu.LoadRegisterSetStatus(cpu.Y);
+	}
+
+	inline void Op_BEQ(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, cpu.FlagZ());
+	}
+
+	inline void Op_BNE(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, !cpu.FlagZ());
+	}
+
+	inline void Op_BPL(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, !cpu.FlagN());
+	}
+
+	inline void Op_BMI(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, cpu.FlagN());
+	}
+
+	inline void Op_BVC(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, !cpu.Status.V);
+	}
+
+	inline void Op_BVS(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, cpu.Status.V);
+	}
+
+	inline void Op_BCC(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, !cpu.Status.C);
+	}
+
+	inline void Op_BCS(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.BranchCondition(Cycles, memory, Operand, cpu.Status.C);
+	}
+
+	inline void Op_CLC(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.C = 0;
+	}
+
+	inline void Op_SEC(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.C = 1;
+	}
+
+	inline void Op_CLI(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.I = 0;
+	}
+
+	inline void Op_SEI(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.I = 1;
+	}
+
+	inline void Op_CLV(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.V = 0;
+	}
+
+	inline void Op_CLD(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.D = 0;
+	}
+
+	inline void Op_SED(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		cpu.Status.D = 1;
+	}
+
+	inline void Op_NOP(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+	}
+
+	inline void Op_JSR(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Word SubAddr = Operand;
+		cpu.PushPCToStack(memory);
+		cpu.PC = SubAddr;
+	}
+
+	inline void Op_RTS(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Word ReturnAddress = cpu.PopWordFromStack(memory);
+		cpu.PC = ReturnAddress;
+	}
+
+	inline void Op_JMP_ABS(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Word Address = Operand;
+#if M6502_IDLE_SKIP
+		const Word JumpAddress = cpu.PC - 3;
+		cpu.PC = Address;
+		if (Address <= JumpAddress && --cpu.Idle.Countdown <= 1)
+		{
+			cpu.SkipIdleLoop(Cycles, memory, JumpAddress);
+		}
+#else
+		cpu.PC = Address;
+#endif
+	}
+
+	inline void Op_JMP_IND(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Word IndAddress = Operand;
+		Word Address = cpu.ReadWord(IndAddress, memory);
+		cpu.PC = Address;
+	}
+
+	/* Every opcode without a handler lands here */
+	inline void Op_NotHandled(CPU& cpu, s32& Cycles, Mem& memory, Word Operand)
+	{
+		Byte Ins = memory.Read(static_cast<Word>(cpu.PC - 1));
+		cpu.PackStatus();
+		printf("Intruction not handled, Ins: %d\tCycles: %d\n", Ins, Cycles);
+		throw - 1;
+	}
+}
+}
@@ -0,0 +1,205 @@
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "pool_6502.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using namespace m6502;
+
+	constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	std::size_t RoundUp(std::size_t Size, std::size_t Alignment)
+	{
+		return (Size + Alignment - 1) / Alignment * Alignment;
+	}
+
+#if defined(_WIN32)
+	void* Allocate(std::size_t Size, DWORD Type, s32 Node)
+	{
+		return (Node == InstancePool::ANY_NODE) ? VirtualAlloc(nullptr, Size, Type, PAGE_READWRITE)
+			: VirtualAllocExNuma(GetCurrentProcess(), nullptr, Size, Type, PAGE_READWRITE, static_cast<DWORD>(Node));
+	}
+#else
+	/* Asks for the pages of [Base, Base + Size) to come from Node, before they are touched */
+	void PreferNode(void* Base, std::size_t Size, s32 Node)
+	{
+#ifdef SYS_mbind
+		constexpr int MPOL_PREFERRED_ = 1;		// <numaif.h> is libnuma's, not always there
+		constexpr u32 BITS = 8 * sizeof(unsigned long);
+		if (Node == InstancePool::ANY_NODE)
+		{
+			return;
+		}
+		std::vector<unsigned long> Nodes(Node / BITS + 1, 0);
+		Nodes[Node / BITS] = 1ul << (Node % BITS);
+		// best effort: a kernel without NUMA leaves the pages where they fall
+		syscall(SYS_mbind, Base, Size, MPOL_PREFERRED_, Nodes.data(), Nodes.size() * BITS + 1, 0);
+#else
+		(void)Base, (void)Size, (void)Node;
+#endif
+	}
+#endif
+
+	/* @return Size bytes of zeroed memory from the OS, on huge pages if Huge and it lets us
+	*	(then Huge stays true), on NUMA node Node unless ANY_NODE, nullptr if it has none */
+	void* AllocateArena(std::size_t Size, bool& Huge, s32 Node)
+	{
+#if defined(_WIN32)
+		if (Huge)
+		{
+			const std::size_t LargePage = GetLargePageMinimum();
+			void* Base = LargePage ? Allocate(RoundUp(Size, LargePage), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, Node) : nullptr;
+			if (Base)
+			{
+				return Base;
+			}
+			Huge = false;
+		}
+		// VirtualAlloc allocations are 64 KB aligned already
+		return Allocate(Size, MEM_RESERVE | MEM_COMMIT, Node);
+#else
+#ifdef MAP_HUGETLB
+		if (Huge)
+		{
+			void* Base = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (Base != MAP_FAILED)
+			{
+				PreferNode(Base, Size, Node);
+				return Base;
+			}
+		}
+#endif
+		void* Base = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (Base != MAP_FAILED)
+		{
+			PreferNode(Base, Size, Node);
+		}
+#ifdef MADV_HUGEPAGE
+		if (Huge && Base != MAP_FAILED)
+		{
+			// transparent huge pages where the kernel has them, no guarantee
+			madvise(Base, Size, MADV_HUGEPAGE);
+		}
+#endif
+		Huge = false;
+		return Base == MAP_FAILED ? nullptr : Base;
+#endif
+	}
+
+	void FreeArena(void* Base, std::size_t Size)
+	{
+#if defined(_WIN32)
+		(void)Size;
+		VirtualFree(Base, 0, MEM_RELEASE);
+#else
+		munmap(Base, Size);
+#endif
+	}
+}
+
+m6502::InstancePool::InstancePool(u32 MachinesPerArena, bool HugePages, s32 Node)
+	: MachinesPerArena(MachinesPerArena ? MachinesPerArena : 1), HugePages(HugePages), Node(Node),
+	SlotSize(RoundUp(sizeof(Machine), SLOT_ALIGNMENT))
+{
+}
+
+m6502::s32 m6502::InstancePool::CurrentNode()
+{
+#if defined(_WIN32)
+	PROCESSOR_NUMBER Processor;
+	USHORT Node = 0;
+	GetCurrentProcessorNumberEx(&Processor);
+	return GetNumaProcessorNodeEx(&Processor, &Node) ? Node : 0;
+#elif defined(SYS_getcpu)
+	unsigned Cpu = 0, Node = 0;
+	return syscall(SYS_getcpu, &Cpu, &Node, nullptr) == 0 ? static_cast<s32>(Node) : 0;
+#else
+	return 0;
+#endif
+}
+
+m6502::InstancePool::~InstancePool()
+{
+	for (const Arena& Each : Allocated)
+	{
+		for (u32 Slot = 0; Slot < Each.Constructed; Slot++)
+		{
+			reinterpret_cast<Machine*>(Each.Slots + Slot * SlotSize)->~Machine();
+		}
+		FreeArena(Each.Base, Each.Size);
+	}
+}
+
+m6502::Machine* m6502::InstancePool::Acquire()
+{
+	Machine* machine = nullptr;
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		if (!Free.empty())
+		{
+			machine = Free.back();
+			Free.pop_back();
+		}
+		else
+		{
+			if ((Allocated.empty() || Allocated.back().Constructed == MachinesPerArena) && !Grow())
+			{
+				return nullptr;
+			}
+			Arena& Last = Allocated.back();
+			machine = new (Last.Slots + Last.Constructed * SlotSize) Machine();
+			Last.Constructed++;
+		}
+	}
+
+	// only the pages the last job wrote or remapped are cleared again
+	machine->memory.MapRam(0, Mem::NUM_PAGES);
+	machine->cpu.Reset(machine->memory);
+	machine->memory.ClearDirty();
+	return machine;
+}
+
+void m6502::InstancePool::Release(Machine* machine)
+{
+	std::lock_guard<std::mutex> Guard(Lock);
+	Free.push_back(machine);
+}
+
+m6502::u32 m6502::InstancePool::Arenas() const
+{
+	std::lock_guard<std::mutex> Guard(Lock);
+	return static_cast<u32>(Allocated.size());
+}
+
+bool m6502::InstancePool::Grow()
+{
+	bool Huge = HugePages;
+	// room to align the first slot
+	std::size_t Size = SlotSize * MachinesPerArena + SLOT_ALIGNMENT;
+	if (Huge)
+	{
+		Size = RoundUp(Size, HUGE_PAGE_SIZE);
+	}
+	void* Base = AllocateArena(Size, Huge, Node);
+	if (!Base)
+	{
+		return false;
+	}
+	HugePagesUsed = Allocated.empty() ? Huge : HugePagesUsed && Huge;
+
+	const std::uintptr_t First = RoundUp(reinterpret_cast<std::uintptr_t>(Base), SLOT_ALIGNMENT);
+	Allocated.push_back(Arena{ Base, Size, reinterpret_cast<Byte*>(First), 0 });
+	return true;
+}
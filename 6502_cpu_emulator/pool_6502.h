@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "main_6502.h"
+
+/* A CPU and the memory it runs in, as InstancePool hands them out */
+struct m6502::Machine
+{
+	Mem memory;		// first, so its RAM starts the slot
+	CPU cpu;
+};
+
+/** Machines for jobs that come and go at a high rate. They are carved out of
+*	large arenas, each slot 64 KB aligned so Mem::Data is too, optionally on huge
+*	pages, and Release only puts them back on a free list: the arenas go back
+*	to the OS with the pool, so a new job does not allocate nor fault pages in.
+*	A recycled Mem keeps its Id, it only ever is reused after Acquire reset it.
+*	Acquire and Release may be called from any thread. */
+struct m6502::InstancePool
+{
+	static constexpr u32 SLOT_ALIGNMENT = 64 * 1024;
+	static constexpr s32 ANY_NODE = -1;
+
+	/* MachinesPerArena machines are allocated at a time, on huge pages if HugePages and the OS lets us,
+	*	and on NUMA node Node if it is not ANY_NODE (the OS falls back to another node when it is full) */
+	explicit InstancePool(u32 MachinesPerArena = 64, bool HugePages = false, s32 Node = ANY_NODE);
+	~InstancePool();
+	InstancePool(const InstancePool&) = delete;
+	InstancePool& operator=(const InstancePool&) = delete;
+
+	/* @return a machine as after CPU::Reset, all RAM (see Mem::MapRam) and nothing dirty.
+	*	nullptr if the OS has no memory for a new arena. */
+	Machine* Acquire();
+
+	/* Gives back a machine from Acquire, it must not be used any more */
+	void Release(Machine* machine);
+
+	/* @return the number of arenas allocated so far */
+	u32 Arenas() const;
+
+	/* @return the NUMA node of the processor the calling thread runs on, 0 if the OS does not tell */
+	static s32 CurrentNode();
+
+	/* @return true if the arenas are on huge pages */
+	bool OnHugePages() const
+	{
+		return HugePagesUsed;
+	}
+
+private:
+	struct Arena
+	{
+		void* Base;			// as the OS gave it, to give it back
+		std::size_t Size;
+		Byte* Slots;		// first slot, SLOT_ALIGNMENT aligned
+		u32 Constructed;	// slots holding a Machine, the first ones
+	};
+
+	/* Allocates one more arena, @return false if the OS has no memory */
+	bool Grow();
+
+	const u32 MachinesPerArena;
+	const bool HugePages;
+	const s32 Node;
+	bool HugePagesUsed = false;		// every arena is on huge pages
+	std::size_t SlotSize;
+
+	mutable std::mutex Lock;
+	std::vector<Arena> Allocated;
+	std::vector<Machine*> Free;
+};
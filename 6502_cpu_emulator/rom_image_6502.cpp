@@ -0,0 +1,125 @@
+#include <map>
+#include <mutex>
+#include <string>
+#include "rom_image_6502.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using namespace m6502;
+
+	/* @return a read-only view of the whole file, nullptr if it cannot be mapped or is empty */
+	void* MapFile(const char* Path, u32& Length)
+	{
+#if defined(_WIN32)
+		HANDLE File = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+		LARGE_INTEGER FileSize;
+		void* View = nullptr;
+		if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0 && FileSize.QuadPart <= 0xFFFFFFFF)
+		{
+			HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (Mapping)
+			{
+				// the view keeps the file mapped once the handles are closed
+				View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(Mapping);
+			}
+			Length = static_cast<u32>(FileSize.QuadPart);
+		}
+		CloseHandle(File);
+		return View;
+#else
+		const int File = open(Path, O_RDONLY);
+		if (File < 0)
+		{
+			return nullptr;
+		}
+		struct stat Info;
+		void* View = nullptr;
+		if (fstat(File, &Info) == 0 && Info.st_size > 0 && static_cast<unsigned long long>(Info.st_size) <= 0xFFFFFFFF)
+		{
+			Length = static_cast<u32>(Info.st_size);
+			View = mmap(nullptr, Length, PROT_READ, MAP_SHARED, File, 0);
+			if (View == MAP_FAILED)
+			{
+				View = nullptr;
+			}
+		}
+		close(File);
+		return View;
+#endif
+	}
+
+	void UnmapFile(void* View, u32 Length)
+	{
+#if defined(_WIN32)
+		(void)Length;
+		UnmapViewOfFile(View);
+#else
+		munmap(View, Length);
+#endif
+	}
+}
+
+std::shared_ptr<const m6502::RomImage> m6502::RomImage::Open(const char* Path)
+{
+	u32 Length = 0;
+	void* View = MapFile(Path, Length);
+	if (!View)
+	{
+		return nullptr;
+	}
+	std::shared_ptr<RomImage> Image(new RomImage());
+	Image->Mapping = View;
+	Image->Bytes = static_cast<const Byte*>(View);
+	Image->Length = Length;
+	return Image;
+}
+
+std::shared_ptr<const m6502::RomImage> m6502::RomImage::Share(const char* Path)
+{
+	static std::mutex Lock;
+	static std::map<std::string, std::weak_ptr<const RomImage>> Open;
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	std::weak_ptr<const RomImage>& Slot = Open[Path];
+	std::shared_ptr<const RomImage> Image = Slot.lock();
+	if (!Image)
+	{
+		Image = RomImage::Open(Path);
+		Slot = Image;
+	}
+	return Image;
+}
+
+std::shared_ptr<const m6502::RomImage> m6502::RomImage::Copy(const Byte* Bytes, u32 Size)
+{
+	std::shared_ptr<RomImage> Image(new RomImage());
+	Image->Copied.assign(Bytes, Bytes + Size);
+	Image->Bytes = Image->Copied.data();
+	Image->Length = Size;
+	return Image;
+}
+
+m6502::RomImage::~RomImage()
+{
+	if (Mapping)
+	{
+		UnmapFile(Mapping, Length);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "main_6502.h"
+
+/** A read-only image, e.g. a ROM, that any number of Mems map (see Mem::MapRom).
+*	Open maps the file instead of reading it, so its pages are the OS's file
+*	cache, shared by every instance and every process that opens it; Share also
+*	hands out the image already open for a path, so it is loaded once.
+*	Images never change once opened and live as long as someone holds them. */
+struct m6502::RomImage
+{
+	/* @return the file mapped read-only, nullptr if it cannot be opened or is empty */
+	static std::shared_ptr<const RomImage> Open(const char* Path);
+
+	/* @return the image someone already holds for Path, else Open(Path) */
+	static std::shared_ptr<const RomImage> Share(const char* Path);
+
+	/* @return a copy of Bytes, for images that are not in a file */
+	static std::shared_ptr<const RomImage> Copy(const Byte* Bytes, u32 Size);
+
+	~RomImage();
+	RomImage(const RomImage&) = delete;
+	RomImage& operator=(const RomImage&) = delete;
+
+	const Byte* Data() const
+	{
+		return Bytes;
+	}
+
+	u32 Size() const
+	{
+		return Length;
+	}
+
+	/* @return true if the image is a mapping of its file, not a copy */
+	bool Mapped() const
+	{
+		return Mapping != nullptr;
+	}
+
+private:
+	RomImage() = default;
+
+	const Byte* Bytes = nullptr;
+	u32 Length = 0;
+	void* Mapping = nullptr;		// the view of the file, nullptr for copies
+	std::vector<Byte> Copied;
+};
@@ -0,0 +1,61 @@
+#include <cstring>
+#include "snapshot_6502.h"
+
+m6502::MemSnapshot::MemSnapshot(const Mem& memory)
+{
+	Take(memory, nullptr);
+}
+
+m6502::MemSnapshot::MemSnapshot(const Mem& memory, const MemSnapshot& Previous)
+{
+	Take(memory, &Previous);
+}
+
+void m6502::MemSnapshot::Take(const Mem& memory, const MemSnapshot* Previous)
+{
+	if (Previous && Previous->MemId != memory.Id)
+	{
+		Previous = nullptr;
+	}
+	MemId = memory.Id;
+	for (u32 Page = 0; Page < Mem::NUM_PAGES; Page++)
+	{
+		Versions[Page] = memory.PageVersion[Page];
+		if (Previous && Previous->Versions[Page] == Versions[Page])
+		{
+			Pages[Page] = Previous->Pages[Page];
+			continue;
+		}
+		auto Copy = std::make_shared<PageData>();
+		std::memcpy(Copy->data(), &memory.Data[Page * Mem::PAGE_SIZE], Mem::PAGE_SIZE);
+		Pages[Page] = std::move(Copy);
+	}
+}
+
+void m6502::MemSnapshot::Restore(Mem& memory) const
+{
+	for (u32 Page = 0; Page < Mem::NUM_PAGES; Page++)
+	{
+		// not written since the snapshot was taken from it
+		if (memory.Id == MemId && memory.PageVersion[Page] == Versions[Page])
+		{
+			continue;
+		}
+		Byte* Data = &memory.Data[Page * Mem::PAGE_SIZE];
+		if (std::memcmp(Data, Pages[Page]->data(), Mem::PAGE_SIZE) != 0)
+		{
+			std::memcpy(Data, Pages[Page]->data(), Mem::PAGE_SIZE);
+			memory.PageWritten(Page);
+		}
+	}
+}
+
+m6502::u32 m6502::MemSnapshot::SharedPages(const MemSnapshot& Other) const
+{
+	u32 Shared = 0;
+	for (u32 Page = 0; Page < Mem::NUM_PAGES; Page++)
+	{
+		Shared += (Pages[Page] == Other.Pages[Page]);
+	}
+	return Shared;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include "main_6502.h"
+
+/** The RAM of a Mem at one point in time, for rewind and branching runs.
+*	Snapshots share their pages: one taken after Previous from the same Mem
+*	only copies the pages written since (see Mem::PageVersion), the others
+*	are Previous's, so many snapshots of one machine cost about the pages
+*	that changed between them. Snapshots never change once taken.
+*	Only the RAM is kept, not the page table or the devices; writes through
+*	Mem::Data directly are not seen. */
+struct m6502::MemSnapshot
+{
+	/* Copies every page of memory */
+	explicit MemSnapshot(const Mem& memory);
+
+	/* Shares the pages memory did not write since Previous was taken from it */
+	MemSnapshot(const Mem& memory, const MemSnapshot& Previous);
+
+	/* Writes the snapshot back to memory, only the pages that differ count as written.
+	*	Pages memory did not write since the snapshot was taken from it are not even compared. */
+	void Restore(Mem& memory) const;
+
+	/* read 1 byte */
+	Byte operator[](u32 Address) const
+	{
+		return (*Pages[Address / Mem::PAGE_SIZE])[Address % Mem::PAGE_SIZE];
+	}
+
+	/* @return the number of pages stored once for both snapshots */
+	u32 SharedPages(const MemSnapshot& Other) const;
+
+private:
+	using PageData = std::array<Byte, Mem::PAGE_SIZE>;
+
+	void Take(const Mem& memory, const MemSnapshot* Previous);
+
+	u32 MemId = 0;							// Mem::Id it was taken from
+	u32 Versions[Mem::NUM_PAGES];			// Mem::PageVersion of each page when taken
+	std::shared_ptr<const PageData> Pages[Mem::NUM_PAGES];
+};
@@ -0,0 +1,50 @@
+#include <cstring>
+#include "sparse_mem_6502.h"
+
+void m6502::SparseMem::Load(Mem& memory) const
+{
+	// the pages written since the last one are the only ones to clear
+	memory.Initialise();
+	for (u32 Page = 0; Page < Mem::NUM_PAGES; Page++)
+	{
+		if (Slots[Page])
+		{
+			std::memcpy(&memory.Data[Page * Mem::PAGE_SIZE], Pages[Slots[Page] - 1].data(), Mem::PAGE_SIZE);
+			memory.PageWritten(Page);
+		}
+	}
+	memory.ClearDirty();
+}
+
+void m6502::SparseMem::Store(const Mem& memory)
+{
+	static const PageData Zeros = {};
+	for (u32 Page = memory.NextDirtyPage(0); Page < Mem::NUM_PAGES; Page = memory.NextDirtyPage(Page + 1))
+	{
+		const Byte* Data = &memory.Data[Page * Mem::PAGE_SIZE];
+		if (!Slots[Page] && std::memcmp(Data, Zeros.data(), Mem::PAGE_SIZE) == 0)
+		{
+			continue;
+		}
+		std::memcpy(Allocate(Page).data(), Data, Mem::PAGE_SIZE);
+	}
+}
+
+void m6502::SparseMem::Write(Word Address, Byte Value)
+{
+	if (Value || Slots[Address / Mem::PAGE_SIZE])
+	{
+		Allocate(Address / Mem::PAGE_SIZE)[Address % Mem::PAGE_SIZE] = Value;
+	}
+}
+
+m6502::SparseMem::PageData& m6502::SparseMem::Allocate(u32 Page)
+{
+	if (!Slots[Page])
+	{
+		Pages.emplace_back();
+		Pages.back().fill(0);
+		Slots[Page] = static_cast<Word>(Pages.size());
+	}
+	return Pages[Slots[Page] - 1];
+}
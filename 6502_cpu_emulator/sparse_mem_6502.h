@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "main_6502.h"
+
+/** The RAM of a machine in the memory it actually uses, to keep many of them around.
+*	A page is only allocated once something other than zeros is written to it,
+*	the others read as zeros and take 2 bytes each: a program that touches the zero
+*	page, the stack and a code page costs under 2 KB instead of a 64 KB Mem.
+*	It runs in a Mem, one per thread is enough: Load puts the RAM in it and Store
+*	takes back the pages it wrote, found with Mem's dirty map. Only the RAM is
+*	kept, the page table and the devices stay with the Mem. */
+struct m6502::SparseMem
+{
+	/* Makes memory's RAM this one, every page it does not hold is zero.
+	*	Forgets memory's dirty map (see Mem::ClearDirty), Store needs it from here on. */
+	void Load(Mem& memory) const;
+
+	/* Takes the pages memory wrote since Load */
+	void Store(const Mem& memory);
+
+	/* read 1 byte */
+	Byte operator[](u32 Address) const
+	{
+		const Word Slot = Slots[Address / Mem::PAGE_SIZE];
+		return Slot ? Pages[Slot - 1][Address % Mem::PAGE_SIZE] : 0;
+	}
+
+	/* write 1 byte, allocating its page the first time it is not zero */
+	void Write(Word Address, Byte Value);
+
+	/* @return the number of pages allocated */
+	u32 AllocatedPages() const
+	{
+		return static_cast<u32>(Pages.size());
+	}
+
+	/* @return the bytes it takes, itself and its pages */
+	u32 Footprint() const
+	{
+		return static_cast<u32>(sizeof(*this) + Pages.capacity() * sizeof(PageData));
+	}
+
+private:
+	using PageData = std::array<Byte, Mem::PAGE_SIZE>;
+
+	/* @return Page's data, allocated and zeroed if it was not */
+	PageData& Allocate(u32 Page);
+
+	Word Slots[Mem::NUM_PAGES] = {};		// 1 + index in Pages of each page, 0 for the zero page
+	std::vector<PageData> Pages;
+};
@@ -0,0 +1,309 @@
+#include <ctype.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "main_6502.h"
+#include "opcodes_6502.h"
+#include "decode_cache_6502.h"
+
+/* Ahead-of-time translator: .prg (2-byte load address + payload) to a C++ translation unit.
+*	Usage: 6502_cpu_emulator_AOT <program.prg> <output.cpp> [FunctionName]
+*
+*	The generated function has the contract of CPU::Execute:
+*		m6502::s32 FunctionName(m6502::CPU& cpu, m6502::Mem& memory, m6502::s32 Cycles);
+*	Code reachable from the load address through branches, JMP and JSR is translated
+*	into straight C++ calling the Ops:: handlers with constant operands. Computed jumps
+*	(JMP ($xxxx), RTS) go through a switch on PC, and anything not translated or
+*	modified since translation runs in the interpreter. */
+
+using namespace m6502;
+
+namespace
+{
+	const char* HandlerName[256] = {};
+
+	void InitHandlerNames()
+	{
+#define M6502_HANDLER_NAME(Name, Mnemonic, Mode, Length, Cycles, PageCross, Branch) HandlerName[CPU::INS_##Name] = #Name;
+		M6502_HANDLED_OPCODES(M6502_HANDLER_NAME)
+#undef M6502_HANDLER_NAME
+	}
+
+	bool IsBranch(Byte Opcode)
+	{
+		return DecodeCache::EndsBlock(Opcode) && Opcode != CPU::INS_JSR && Opcode != CPU::INS_RTS &&
+			Opcode != CPU::INS_JMP_ABS && Opcode != CPU::INS_JMP_IND;
+	}
+
+	/* @return true if the instruction may write memory anywhere in [Low, High] */
+	bool MayWrite(const MicroOp& Op, Word Low, Word High)
+	{
+		switch (Op.Opcode)
+		{
+		case CPU::INS_STA_ZP: case CPU::INS_STX_ZP: case CPU::INS_STY_ZP:
+		case CPU::INS_STA_ABS: case CPU::INS_STX_ABS: case CPU::INS_STY_ABS:
+		case CPU::INS_INC_ZP: case CPU::INS_INC_ABS: case CPU::INS_DEC_ZP: case CPU::INS_DEC_ABS:
+			return Op.Operand >= Low && Op.Operand <= High;
+		case CPU::INS_STA_ZPX: case CPU::INS_STX_ZPY: case CPU::INS_STY_ZPX:
+		case CPU::INS_INC_ZPX: case CPU::INS_DEC_ZPX:
+			return Low <= 0x00FF;
+		case CPU::INS_STA_ABSX: case CPU::INS_STA_ABSY: case CPU::INS_STA_INDX: case CPU::INS_STA_INDY:
+		case CPU::INS_INC_ABSX: case CPU::INS_DEC_ABSX:
+			return true;
+		case CPU::INS_PHA: case CPU::INS_PHP: case CPU::INS_JSR:
+			return Low <= 0x01FF && High >= 0x0100;
+		default:
+			return false;
+		}
+	}
+
+	class Translator
+	{
+	public:
+		Mem Image;
+		Word LoadAddress = 0;
+		u32 End = 0;						// one past the last loaded byte
+		std::map<Word, MicroOp> Code;		// decoded instructions by address
+		std::set<Word> Labels;				// block entry points
+
+		bool Load(std::vector<Byte>& Program)
+		{
+			CPU cpu;
+			cpu.Reset(Image);
+			LoadAddress = cpu.LoadPrg(Program.data(), static_cast<u32>(Program.size()), Image);
+			End = LoadAddress + static_cast<u32>(Program.size()) - 2;
+			return Program.size() > 2 && End <= Mem::MAX_MEM;
+		}
+
+		bool InImage(u32 Address, u32 Bytes) const
+		{
+			return Address >= LoadAddress && Address + Bytes <= End;
+		}
+
+		/* Recovers the control flow reachable from the load address */
+		void Explore()
+		{
+			std::vector<Word> Pending = { LoadAddress };
+			Labels.insert(LoadAddress);
+			auto AddLabel = [&](Word Address)
+			{
+				Labels.insert(Address);
+				Pending.push_back(Address);
+			};
+			while (!Pending.empty())
+			{
+				Word PC = Pending.back();
+				Pending.pop_back();
+				while (Code.find(PC) == Code.end())
+				{
+					MicroOp Op = CPU::Decode(PC, Image);
+					if (!Op.Handler || !InImage(PC, Op.Length))
+					{
+						break;
+					}
+					Code[PC] = Op;
+					const Word Next = PC + Op.Length;
+					if (IsBranch(Op.Opcode))
+					{
+						AddLabel(Next + static_cast<sByte>(Op.Operand));
+						AddLabel(Next);
+						break;
+					}
+					if (Op.Opcode == CPU::INS_JMP_ABS)
+					{
+						AddLabel(Op.Operand);
+						break;
+					}
+					if (Op.Opcode == CPU::INS_JSR)
+					{
+						AddLabel(Op.Operand);
+						AddLabel(Next);		// RTS comes back here
+						break;
+					}
+					if (Op.Opcode == CPU::INS_RTS || Op.Opcode == CPU::INS_JMP_IND)
+					{
+						break;
+					}
+					PC = Next;
+				}
+			}
+			// keep only labels that start translated code
+			for (auto It = Labels.begin(); It != Labels.end();)
+			{
+				It = (Code.find(*It) == Code.end()) ? Labels.erase(It) : std::next(It);
+			}
+		}
+
+		std::string Goto(Word Address) const
+		{
+			char Buffer[32];
+			if (Labels.count(Address))
+			{
+				snprintf(Buffer, sizeof(Buffer), "goto L_%04X;", Address);
+				return Buffer;
+			}
+			return "goto Dispatch;";
+		}
+
+		/* @return the bytes of the straight-line block starting at Label */
+		u32 BlockBytes(Word Label) const
+		{
+			u32 PC = Label;
+			for (;;)
+			{
+				const MicroOp& Op = Code.at(static_cast<Word>(PC));
+				PC += Op.Length;
+				if (DecodeCache::EndsBlock(Op.Opcode) || !Code.count(static_cast<Word>(PC)) || Labels.count(static_cast<Word>(PC)))
+				{
+					return PC - Label;
+				}
+			}
+		}
+
+		void EmitBlock(FILE* Out, Word Label) const
+		{
+			const u32 Bytes = BlockBytes(Label);
+			const Word Last = static_cast<Word>(Label + Bytes - 1);
+			fprintf(Out, "L_%04X:\n", Label);
+			fprintf(Out, "\tif (!Unmodified(memory, 0x%04X, %u)) goto Fallback;\n", Label, Bytes);
+			u32 PC = Label;
+			while (PC < static_cast<u32>(Label) + Bytes)
+			{
+				const MicroOp& Op = Code.at(static_cast<Word>(PC));
+				const Word Next = static_cast<Word>(PC + Op.Length);
+				fprintf(Out, "\tif (Cycles <= 0) goto Done;\n");
+				fprintf(Out, "\tcpu.PC = 0x%04X; Cycles -= %u; Ops::Op_%s(cpu, Cycles, memory, 0x%04X);\t// $%04X %s\n",
+					Next, Op.Cycles, HandlerName[Op.Opcode], Op.Operand, PC, OpcodeTable[Op.Opcode].Mnemonic);
+				PC += Op.Length;
+
+				if (IsBranch(Op.Opcode))
+				{
+					const Word Target = Next + static_cast<sByte>(Op.Operand);
+					fprintf(Out, "\tif (cpu.PC == 0x%04X) %s\n", Target, Goto(Target).c_str());
+					fprintf(Out, "\t%s\n", Goto(Next).c_str());
+				}
+				else if (Op.Opcode == CPU::INS_JMP_ABS || Op.Opcode == CPU::INS_JSR)
+				{
+					fprintf(Out, "\t%s\n", Goto(Op.Operand).c_str());
+				}
+				else if (Op.Opcode == CPU::INS_RTS || Op.Opcode == CPU::INS_JMP_IND)
+				{
+					fprintf(Out, "\tgoto Dispatch;\n");
+				}
+				else if (PC < static_cast<u32>(Label) + Bytes && MayWrite(Op, static_cast<Word>(PC), Last))
+				{
+					// the store may have patched the rest of this block
+					fprintf(Out, "\tif (!Unmodified(memory, 0x%04X, %u)) goto Dispatch;\n", PC, Last + 1 - PC);
+				}
+				else if (PC == static_cast<u32>(Label) + Bytes)
+				{
+					fprintf(Out, "\t%s\n", Goto(static_cast<Word>(PC)).c_str());
+				}
+			}
+			fprintf(Out, "\n");
+		}
+
+		void Emit(FILE* Out, const char* Source, const char* FunctionName) const
+		{
+			fprintf(Out, "/* Generated by 6502_cpu_emulator_AOT from %s, do not edit.\n", Source);
+			fprintf(Out, "*\tm6502::s32 %s(m6502::CPU& cpu, m6502::Mem& memory, m6502::s32 Cycles);\n", FunctionName);
+			fprintf(Out, "*\truns the program like CPU::Execute, @return the number of cycles that were used */\n");
+			fprintf(Out, "#include <cstring>\n#include \"opcodes_6502.h\"\n\n");
+			fprintf(Out, "namespace\n{\n\tusing namespace m6502;\n\n");
+			fprintf(Out, "\tconstexpr Word LOAD_ADDRESS = 0x%04X;\n\n", LoadAddress);
+			fprintf(Out, "\tconst Byte Image[] = {");
+			for (u32 i = LoadAddress; i < End; i++)
+			{
+				fprintf(Out, "%s0x%02X,", ((i - LoadAddress) % 16 == 0) ? "\n\t\t" : " ", Image[i]);
+			}
+			fprintf(Out, "\n\t};\n\n");
+			fprintf(Out, "\t/* @return true if the CPU still fetches the translated bytes at Address from RAM */\n");
+			fprintf(Out, "\tinline bool Unmodified(const Mem& memory, Word Address, u32 Bytes)\n\t{\n");
+			fprintf(Out, "\t\treturn memory.ReadsRam(Address) && memory.ReadsRam(static_cast<Word>(Address + Bytes - 1)) &&\n");
+			fprintf(Out, "\t\t\tstd::memcmp(&memory.Data[Address], &Image[Address - LOAD_ADDRESS], Bytes) == 0;\n\t}\n}\n\n");
+
+			fprintf(Out, "m6502::s32 %s(m6502::CPU& cpu, m6502::Mem& memory, m6502::s32 Cycles)\n{\n", FunctionName);
+			fprintf(Out, "\tusing namespace m6502;\n");
+			fprintf(Out, "\tconst s32 CycleRequested = Cycles;\n\tcpu.UnpackStatus();\n\n");
+			fprintf(Out, "Dispatch:\n\tif (Cycles <= 0) goto Done;\n\tswitch (cpu.PC)\n\t{\n");
+			for (Word Label : Labels)
+			{
+				fprintf(Out, "\tcase 0x%04X: goto L_%04X;\n", Label, Label);
+			}
+			fprintf(Out, "\tdefault: break;\n\t}\n");
+			fprintf(Out, "Fallback:\n\tif (Cycles <= 0) goto Done;\n\tCycles -= cpu.Interpret(1, memory);\n\tgoto Dispatch;\n\n");
+			for (Word Label : Labels)
+			{
+				EmitBlock(Out, Label);
+			}
+			fprintf(Out, "Done:\n\tcpu.PackStatus();\n\treturn CycleRequested - Cycles;\n}\n");
+		}
+	};
+
+	bool ReadFile(const char* Path, std::vector<Byte>& Bytes)
+	{
+		FILE* File = fopen(Path, "rb");
+		if (!File)
+		{
+			return false;
+		}
+		Byte Buffer[4096];
+		size_t Read;
+		while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+		{
+			Bytes.insert(Bytes.end(), Buffer, Buffer + Read);
+		}
+		fclose(File);
+		return true;
+	}
+
+	/* "c64_program/test_code.prg" -> "Run_test_code" */
+	std::string DefaultFunctionName(const std::string& Path)
+	{
+		size_t Start = Path.find_last_of("/\\");
+		Start = (Start == std::string::npos) ? 0 : Start + 1;
+		std::string Name = "Run_" + Path.substr(Start, Path.find_last_of('.') - Start);
+		for (char& c : Name)
+		{
+			if (!isalnum(static_cast<unsigned char>(c))) c = '_';
+		}
+		return Name;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		printf("Usage: %s <program.prg> <output.cpp> [FunctionName]\n", argv[0]);
+		return 1;
+	}
+	InitHandlerNames();
+
+	std::vector<Byte> Program;
+	if (!ReadFile(argv[1], Program))
+	{
+		printf("Cannot read %s\n", argv[1]);
+		return 1;
+	}
+	static Translator translator;
+	if (!translator.Load(Program))
+	{
+		printf("%s is not a valid .prg image\n", argv[1]);
+		return 1;
+	}
+	translator.Explore();
+
+	FILE* Out = fopen(argv[2], "w");
+	if (!Out)
+	{
+		printf("Cannot write %s\n", argv[2]);
+		return 1;
+	}
+	const std::string FunctionName = (argc > 3) ? argv[3] : DefaultFunctionName(argv[1]);
+	translator.Emit(Out, argv[1], FunctionName.c_str());
+	fclose(Out);
+	printf("%s: %zu instructions in %zu blocks\n", argv[2], translator.Code.size(), translator.Labels.size());
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "main_6502.h"
+#include "batch_6502.h"
+#include "fork_server_6502.h"
+#include "pool_6502.h"
+
+using namespace m6502;
+
+/* Usage: batch [--threads N] [--pin] [--cycles N] [--repeat N] [--dump FIRST:COUNT]... file.prg...
+*		  runs every file --repeat times (1), each run on a CPU of its own starting at the
+*		  load address with a budget of --cycles cycles (1000000), on --threads threads
+*		  (one per hardware thread), pinned to processors with their machines on the
+*		  NUMA node of each with --pin. Prints a line per run: the file, the registers it
+*		  ended with, the cycles it used and the bytes of each --dump range in hex.
+*		  batch --serve SOCKET|- [--threads N] file.prg
+*		  loads the file and serves jobs from it (see ForkServer), --threads at a time,
+*		  from the Unix-domain socket SOCKET or from stdin to stdout with -. */
+static int Serve(const char* Where, u32 Children, const char* File)
+{
+	std::unique_ptr<Machine> Ready(new Machine());
+	Ready->cpu.Reset(Ready->memory);
+	Word LoadAddress;
+	if (!Ready->cpu.LoadPrgFile(File, Ready->memory, LoadAddress))
+	{
+		printf("cannot load %s\n", File);
+		return 1;
+	}
+	Ready->cpu.PC = LoadAddress;
+
+	ForkServer Server(*Ready, Children ? Children : std::thread::hardware_concurrency());
+	const bool Served = (std::strcmp(Where, "-") == 0) ? Server.Serve(0, 1) : Server.Listen(Where);
+	if (!Served)
+	{
+		fprintf(stderr, "cannot serve on %s\n", Where);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	u32 Threads = 0;
+	BatchPlacement Placement = BatchPlacement::Any;
+	const char* ServeOn = nullptr;
+	u32 Repeat = 1;
+	s32 Cycles = 1000000;
+	std::vector<BatchRange> Ranges;
+	std::vector<const char*> Files;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			Threads = static_cast<u32>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+		{
+			ServeOn = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--pin") == 0)
+		{
+			Placement = BatchPlacement::Pinned;
+		}
+		else if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+		{
+			Cycles = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+		{
+			Repeat = static_cast<u32>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+		{
+			unsigned First = 0, Count = 0;
+			if (std::sscanf(argv[++i], "%x:%u", &First, &Count) != 2 || First >= Mem::MAX_MEM)
+			{
+				printf("bad range %s, expected FIRST:COUNT with FIRST in hex\n", argv[i]);
+				return 1;
+			}
+			Ranges.push_back(BatchRange{ static_cast<Word>(First), Count });
+		}
+		else
+		{
+			Files.push_back(argv[i]);
+		}
+	}
+	if (Files.empty())
+	{
+		printf("usage: batch [--threads N] [--pin] [--cycles N] [--repeat N] [--dump FIRST:COUNT]... file.prg...\n"
+			"       batch --serve SOCKET|- [--threads N] file.prg\n");
+		return 1;
+	}
+	if (ServeOn)
+	{
+		return Serve(ServeOn, Threads, Files[0]);
+	}
+
+	std::vector<BatchJob> Jobs;
+	std::vector<const char*> Names;
+	for (const char* File : Files)
+	{
+		BatchJob Job;
+		Job.Program = RomImage::Share(File);
+		if (!Job.Program || Job.Program->Size() <= 2)
+		{
+			printf("cannot load %s\n", File);
+			return 1;
+		}
+		Job.Start.PC = static_cast<Word>(Job.Program->Data()[0] | (Job.Program->Data()[1] << 8));
+		Job.Cycles = Cycles;
+		Job.Ranges = Ranges;
+		for (u32 i = 0; i < Repeat; i++)
+		{
+			Jobs.push_back(Job);
+			Names.push_back(File);
+		}
+	}
+
+	auto Start = std::chrono::steady_clock::now();
+	const std::vector<BatchResult> Results = RunBatch(Jobs, Threads, Placement);
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	u64 TotalCycles = 0;
+	for (std::size_t i = 0; i < Results.size(); i++)
+	{
+		const BatchResult& Result = Results[i];
+		printf("%s A=%02X X=%02X Y=%02X SP=%02X PC=%04X PS=%02X cycles=%d%s", Names[i],
+			Result.End.A, Result.End.X, Result.End.Y, Result.End.SP, Result.End.PC, Result.End.PS,
+			Result.CyclesUsed, Result.Failed ? " failed" : "");
+		for (const std::vector<Byte>& Range : Result.Ranges)
+		{
+			printf(" ");
+			for (Byte Value : Range)
+			{
+				printf("%02X", Value);
+			}
+		}
+		printf("\n");
+		TotalCycles += Result.CyclesUsed;
+	}
+	fprintf(stderr, "%zu jobs in %.3f s, %.1f M cycles/s\n", Results.size(), Seconds, TotalCycles / Seconds / 1e6);
+	return 0;
+}
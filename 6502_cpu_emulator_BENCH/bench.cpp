@@ -0,0 +1,556 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "main_6502.h"
+#include "opcode_info_6502.h"
+#include "decode_cache_6502.h"
+#include "jit_6502.h"
+#include "snapshot_6502.h"
+#include "sparse_mem_6502.h"
+#include "pool_6502.h"
+#include "lockstep_6502.h"
+#include "cpu_pool_6502.h"
+#include "batch_6502.h"
+#include "fork_server_6502.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+using namespace m6502;
+
+/* Mixed workload: an ALU/store loop over a table with a subroutine call per iteration */
+static Byte MixedPrg[] = {
+	0x00, 0x10,					// load address $1000
+	0xA2, 0x00,					// $1000 LDX #$00
+	0xA9, 0x00,					// $1002 LDA #$00
+	0x18,						// $1004 CLC
+	0x7D, 0x00, 0x20,			// $1005 ADC $2000,X
+	0x9D, 0x00, 0x30,			// $1008 STA $3000,X
+	0x45, 0x90,					// $100B EOR $90
+	0x85, 0x90,					// $100D STA $90
+	0x20, 0x1A, 0x10,			// $100F JSR $101A
+	0xE8,						// $1012 INX
+	0xE0, 0x80,					// $1013 CPX #$80
+	0xD0, 0xED,					// $1015 BNE $1004
+	0x4C, 0x00, 0x10,			// $1017 JMP $1000
+	0xC8,						// $101A INY
+	0x29, 0x7F,					// $101B AND #$7F
+	0x60,						// $101D RTS
+};
+
+/* Idle workload: nested delay loops around one memory update, like most software waiting for time to pass */
+static Byte IdlePrg[] = {
+	0x00, 0x10,					// load address $1000
+	0xE6, 0x90,					// $1000 INC $90
+	0xA0, 0x08,					// $1002 LDY #$08
+	0xA2, 0x00,					// $1004 LDX #$00
+	0xCA,						// $1006 DEX
+	0xD0, 0xFD,					// $1007 BNE $1006
+	0x88,						// $1009 DEY
+	0xD0, 0xF8,					// $100A BNE $1004
+	0x4C, 0x00, 0x10,			// $100C JMP $1000
+};
+
+/* c64_program/test_code.prg */
+static Byte TestCodePrg[] = { 0x00, 0x10, 0xa9, 0xff, 0x85, 0x90, 0x8d,
+								0x00, 0x80, 0x49, 0xcc, 0x4c, 0x02, 0x10 };
+
+/* Counts the instructions executed for a given number of cycles */
+static u32 CountInstructions(Byte* Program, u32 nBytes, s32 Cycles)
+{
+	Mem mem;
+	CPU cpu;
+	cpu.Reset(mem);
+	cpu.PC = cpu.LoadPrg(Program, nBytes, mem);
+	u32 Instructions = 0;
+	while (Cycles > 0)
+	{
+		Cycles -= cpu.Execute(1, mem);
+		Instructions++;
+	}
+	return Instructions;
+}
+
+enum class Engine { Interpreter, Cached, Jit };
+static const char* EngineNames[] = { "", "cached", "jit" };
+
+static void RunBenchmark(const char* Name, Byte* Program, u32 nBytes, Engine engine)
+{
+	constexpr s32 SLICE_CYCLES = 20000;
+	constexpr u32 SLICES = 5000;
+
+	const double InsPerCycle =
+		static_cast<double>(CountInstructions(Program, nBytes, SLICE_CYCLES)) / SLICE_CYCLES;
+
+	Mem mem;
+	CPU cpu;
+	DecodeCache Cache;
+	Jit jit;
+	cpu.Reset(mem);
+	cpu.PC = cpu.LoadPrg(Program, nBytes, mem);
+
+	long long CyclesUsed = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < SLICES; i++)
+	{
+		switch (engine)
+		{
+		case Engine::Interpreter: CyclesUsed += cpu.Execute(SLICE_CYCLES, mem); break;
+		case Engine::Cached: CyclesUsed += cpu.Execute(SLICE_CYCLES, mem, Cache); break;
+		case Engine::Jit: CyclesUsed += cpu.Execute(SLICE_CYCLES, mem, jit); break;
+		}
+	}
+	auto End = std::chrono::steady_clock::now();
+	const double Seconds = std::chrono::duration<double>(End - Start).count();
+
+	printf("%-10s %-8s %8.1f M cycles/s %8.1f M instructions/s\n", Name, EngineNames[static_cast<int>(engine)],
+		CyclesUsed / Seconds / 1e6, CyclesUsed * InsPerCycle / Seconds / 1e6);
+}
+
+/* Prints the opcode pairs Program executes most often, to pick what DecodeCache fuses */
+static void ReportPairs(const char* Name, Byte* Program, u32 nBytes)
+{
+	constexpr s32 CYCLES = 1000000;
+	constexpr u32 TOP = 10;
+
+	Mem mem;
+	CPU cpu;
+	cpu.Reset(mem);
+	cpu.PC = cpu.LoadPrg(Program, nBytes, mem);
+
+	std::vector<u32> Count(256 * 256, 0);
+	u32 Total = 0;
+	s32 Cycles = CYCLES;
+	s32 Previous = -1;
+	try
+	{
+		while (Cycles > 0)
+		{
+			const Byte Opcode = mem.Data[cpu.PC];
+			if (Previous >= 0)
+			{
+				Count[Previous * 256 + Opcode]++;
+				Total++;
+			}
+			Previous = Opcode;
+			Cycles -= cpu.Execute(1, mem);
+		}
+	}
+	catch (int)
+	{
+		// ran into an unhandled opcode, report what ran until then
+	}
+
+	std::vector<u32> Pairs(Count.size());
+	for (u32 i = 0; i < Pairs.size(); i++)
+	{
+		Pairs[i] = i;
+	}
+	std::partial_sort(Pairs.begin(), Pairs.begin() + TOP, Pairs.end(),
+		[&Count](u32 a, u32 b) { return Count[a] > Count[b]; });
+
+	printf("%s: %u pairs\n", Name, Total);
+	for (u32 i = 0; i < TOP && Count[Pairs[i]] > 0; i++)
+	{
+		const Byte First = static_cast<Byte>(Pairs[i] / 256), Second = static_cast<Byte>(Pairs[i] % 256);
+		printf("  %02X %-3s  %02X %-3s %6.2f%%\n", First, OpcodeTable[First].Mnemonic,
+			Second, OpcodeTable[Second].Mnemonic, 100.0 * Count[Pairs[i]] / Total);
+	}
+}
+
+/* Prints the cost of CPU::Reset after Pages pages were written, and of restoring a snapshot */
+static void ReportReset(u32 Pages)
+{
+	constexpr u32 RESETS = 20000;
+
+	Mem mem;
+	CPU cpu;
+	cpu.Reset(mem);
+	cpu.LoadPrg(MixedPrg, sizeof(MixedPrg), mem);
+	const MemSnapshot Baseline(mem);
+
+	double ResetSeconds = 0, RestoreSeconds = 0;
+	for (u32 i = 0; i < RESETS; i++)
+	{
+		for (u32 Page = 0; Page < Pages; Page++)
+		{
+			mem.Write(static_cast<Word>(Page * Mem::PAGE_SIZE + i % Mem::PAGE_SIZE), static_cast<Byte>(i | 1));
+		}
+		auto Start = std::chrono::steady_clock::now();
+		Baseline.Restore(mem);
+		auto Restored = std::chrono::steady_clock::now();
+		cpu.Reset(mem);
+		auto End = std::chrono::steady_clock::now();
+		RestoreSeconds += std::chrono::duration<double>(Restored - Start).count();
+		ResetSeconds += std::chrono::duration<double>(End - Restored).count();
+	}
+	printf("reset     %3u pages written %8.1f ns/reset %8.1f ns/restore\n", Pages,
+		ResetSeconds / RESETS * 1e9, RestoreSeconds / RESETS * 1e9);
+}
+
+/* Prints the footprint of Instances machines kept in SparseMems, taking turns in one Mem */
+static void ReportSparse(u32 Instances)
+{
+	constexpr s32 SLICE_CYCLES = 2000;
+
+	std::vector<SparseMem> Rams(Instances);
+	std::vector<CPU> Cpus(Instances);
+	Mem mem;
+	for (u32 i = 0; i < Instances; i++)
+	{
+		for (u32 At = 2; At < sizeof(MixedPrg); At++)
+		{
+			Rams[i].Write(static_cast<Word>(0x1000 + At - 2), MixedPrg[At]);
+		}
+		Cpus[i].Reset(mem, 0x1000);
+	}
+
+	auto Start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < Instances; i++)
+	{
+		Rams[i].Load(mem);
+		Cpus[i].Execute(SLICE_CYCLES, mem);
+		Rams[i].Store(mem);
+	}
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	u64 Bytes = 0;
+	for (const SparseMem& Ram : Rams)
+	{
+		Bytes += Ram.Footprint();
+	}
+	printf("sparse %7u instances %8.1f bytes each (Mem %u) %8.1f ns/slice of %d cycles\n", Instances,
+		double(Bytes) / Instances, u32(sizeof(Mem)), Seconds / Instances * 1e9, SLICE_CYCLES);
+}
+
+/* Prints the cost of a short job on a new Machine and on one from an InstancePool */
+static void ReportPool(bool HugePages)
+{
+	constexpr u32 JOBS = 20000;
+	constexpr s32 JOB_CYCLES = 2000;
+
+	auto RunJob = [](Machine& machine)
+	{
+		machine.cpu.PC = machine.cpu.LoadPrg(MixedPrg, sizeof(MixedPrg), machine.memory);
+		machine.cpu.Execute(JOB_CYCLES, machine.memory);
+	};
+
+	auto Start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < JOBS; i++)
+	{
+		Machine* machine = new Machine();
+		machine->cpu.Reset(machine->memory);
+		RunJob(*machine);
+		delete machine;
+	}
+	auto Allocated = std::chrono::steady_clock::now();
+	InstancePool Pool(64, HugePages);
+	for (u32 i = 0; i < JOBS; i++)
+	{
+		Machine* machine = Pool.Acquire();
+		RunJob(*machine);
+		Pool.Release(machine);
+	}
+	auto End = std::chrono::steady_clock::now();
+	printf("new       %8.1f ns/job\npool%s %8.1f ns/job\n",
+		std::chrono::duration<double>(Allocated - Start).count() / JOBS * 1e9, Pool.OnHugePages() ? "(huge)" : "      ",
+		std::chrono::duration<double>(End - Allocated).count() / JOBS * 1e9);
+}
+
+/* Prints the time of 32 machines running Program on tables of their own, one after the other
+*	on CPU::Execute and together in a Lockstep */
+static void ReportLockstep(const char* Name, Byte* Program, u32 nBytes)
+{
+	constexpr u32 LANES = Lockstep::MAX_LANES;
+	constexpr s32 CYCLES = 2000000;
+
+	std::vector<std::unique_ptr<Mem>> Memories;
+	std::vector<CPU> Cpus(LANES);
+	for (u32 i = 0; i < 2 * LANES; i++)
+	{
+		Memories.emplace_back(new Mem());
+		Mem& memory = *Memories.back();
+		Cpus[i % LANES].Reset(memory, 0x1000);
+		Cpus[i % LANES].LoadPrg(Program, nBytes, memory);
+		for (u32 At = 0; At < 0x100; At++)
+		{
+			memory[0x2000 + At] = static_cast<Byte>((i % LANES) * 37 + At * 11);
+		}
+	}
+
+	auto Start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < LANES; i++)
+	{
+		CPU cpu = Cpus[i];
+		cpu.Execute(CYCLES, *Memories[i]);
+	}
+	auto Scalar = std::chrono::steady_clock::now();
+	std::unique_ptr<Lockstep> Lanes(new Lockstep());
+	for (u32 i = 0; i < LANES; i++)
+	{
+		Lanes->AddLane(Cpus[i], *Memories[LANES + i]);
+	}
+	Lanes->Execute(CYCLES);
+	auto End = std::chrono::steady_clock::now();
+	printf("%-10s 32 x %d cycles: execute %8.2f ms lockstep %8.2f ms (%llu group steps, %llu lane steps)\n",
+		Name, CYCLES, std::chrono::duration<double>(Scalar - Start).count() * 1e3,
+		std::chrono::duration<double>(End - Scalar).count() * 1e3,
+		static_cast<unsigned long long>(Lanes->GroupSteps), static_cast<unsigned long long>(Lanes->LaneSteps));
+}
+
+/* Prints the time of a pass over the registers of Instances CPUs (the PC page they are in,
+*	the flags set), each in a Machine of an InstancePool and all in a CPUPool */
+static void ReportCPUPool(u32 Instances)
+{
+	constexpr u32 PASSES = 200;
+
+	InstancePool Machines(64);
+	std::vector<Machine*> Acquired;
+	CPUPool Pool;
+	for (u32 i = 0; i < Instances; i++)
+	{
+		Machine* machine = Machines.Acquire();
+		machine->cpu.PC = static_cast<Word>(i * 97);
+		machine->cpu.PS.Reg = static_cast<Byte>(i);
+		Acquired.push_back(machine);
+		Pool.Add(machine->cpu);
+	}
+
+	u32 Pages[Mem::NUM_PAGES] = {};
+	u32 Carries = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (u32 Pass = 0; Pass < PASSES; Pass++)
+	{
+		for (const Machine* machine : Acquired)
+		{
+			Pages[machine->cpu.PC / Mem::PAGE_SIZE]++;
+			Carries += machine->cpu.PS.Flags.C;
+		}
+	}
+	auto Scattered = std::chrono::steady_clock::now();
+	for (u32 Pass = 0; Pass < PASSES; Pass++)
+	{
+		for (u32 i = 0; i < Pool.Size(); i++)
+		{
+			Pages[Pool.PC[i] / Mem::PAGE_SIZE]++;
+			Carries += Pool.PS[i].Flags.C;
+		}
+	}
+	auto End = std::chrono::steady_clock::now();
+	for (Machine* machine : Acquired)
+	{
+		Machines.Release(machine);
+	}
+	printf("%u CPUs: in machines %8.2f ns/CPU, in a CPUPool %8.2f ns/CPU (%u)\n", Instances,
+		std::chrono::duration<double>(Scattered - Start).count() / PASSES / Instances * 1e9,
+		std::chrono::duration<double>(End - Scattered).count() / PASSES / Instances * 1e9, Carries + Pages[0]);
+}
+
+/* Prints the throughput of RunBatch from 1 thread to one per hardware thread,
+*	with the threads where the OS puts them and pinned with their machines on their NUMA node */
+static void ReportScaling()
+{
+	constexpr s32 JOB_CYCLES = 200000;
+
+	const u32 Hardware = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+	std::vector<BatchJob> Jobs(64 * Hardware);
+	for (BatchJob& Job : Jobs)
+	{
+		Job.Program = RomImage::Copy(MixedPrg, sizeof(MixedPrg));
+		Job.Start.PC = 0x1000;
+		Job.Cycles = JOB_CYCLES;
+	}
+
+	std::vector<u32> Counts;
+	for (u32 Threads = 1; Threads < Hardware; Threads *= 2)
+	{
+		Counts.push_back(Threads);
+	}
+	Counts.push_back(Hardware);
+	for (u32 Threads : Counts)
+	{
+		double JobsPerSecond[2];
+		for (BatchPlacement Placement : { BatchPlacement::Any, BatchPlacement::Pinned })
+		{
+			auto Start = std::chrono::steady_clock::now();
+			RunBatch(Jobs, Threads, Placement);
+			const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+			JobsPerSecond[Placement == BatchPlacement::Pinned] = Jobs.size() / Seconds;
+		}
+		printf("%3u threads: %10.0f jobs/s, pinned %10.0f jobs/s (jobs of %d cycles)\n",
+			Threads, JobsPerSecond[0], JobsPerSecond[1], JOB_CYCLES);
+	}
+}
+
+/* Prints the cost of a short job on a new Machine and through a ForkServer booted once */
+static void ReportFork()
+{
+#if defined(__unix__) || defined(__APPLE__)
+	constexpr u32 JOBS = 2000;
+	constexpr s32 JOB_CYCLES = 2000;
+
+	auto Start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < JOBS; i++)
+	{
+		std::unique_ptr<Machine> machine(new Machine());
+		machine->cpu.Reset(machine->memory);
+		machine->cpu.PC = machine->cpu.LoadPrg(MixedPrg, sizeof(MixedPrg), machine->memory);
+		machine->cpu.X = static_cast<Byte>(i);
+		machine->cpu.Execute(JOB_CYCLES, machine->memory);
+	}
+	auto Created = std::chrono::steady_clock::now();
+
+	std::unique_ptr<Machine> Ready(new Machine());
+	Ready->cpu.Reset(Ready->memory);
+	Ready->cpu.PC = Ready->cpu.LoadPrg(MixedPrg, sizeof(MixedPrg), Ready->memory);
+	int Jobs[2], Results[2];
+	if (pipe(Jobs) != 0 || pipe(Results) != 0)
+	{
+		return;
+	}
+	auto Forked = std::chrono::steady_clock::now();
+	std::thread Feed([&]()
+	{
+		char Line[64];
+		for (u32 i = 0; i < JOBS; i++)
+		{
+			const int Size = snprintf(Line, sizeof(Line), "X=%02X cycles=%d\n", i & 0xFF, JOB_CYCLES);
+			if (write(Jobs[1], Line, Size) != Size)
+			{
+				break;
+			}
+		}
+		close(Jobs[1]);
+	});
+	u32 Answered = 0;
+	std::thread Drain([&]()
+	{
+		char Buffer[4096];
+		ssize_t Read;
+		while ((Read = read(Results[0], Buffer, sizeof(Buffer))) > 0)
+		{
+			Answered += static_cast<u32>(std::count(Buffer, Buffer + Read, '\n'));
+		}
+	});
+	ForkServer(*Ready, std::thread::hardware_concurrency()).Serve(Jobs[0], Results[1]);
+	close(Results[1]);
+	Feed.join();
+	Drain.join();
+	auto End = std::chrono::steady_clock::now();
+	close(Jobs[0]);
+	close(Results[0]);
+	printf("new machine %8.1f us/job\nforked      %8.1f us/job (%u answers, jobs of %d cycles)\n",
+		std::chrono::duration<double>(Created - Start).count() / JOBS * 1e6,
+		std::chrono::duration<double>(End - Forked).count() / JOBS * 1e6, Answered, JOB_CYCLES);
+#else
+	printf("forking needs a POSIX system\n");
+#endif
+}
+
+static bool ReadFile(const char* Path, std::vector<Byte>& Bytes)
+{
+	FILE* File = fopen(Path, "rb");
+	if (!File)
+	{
+		return false;
+	}
+	Byte Buffer[4096];
+	size_t Read;
+	while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+	{
+		Bytes.insert(Bytes.end(), Buffer, Buffer + Read);
+	}
+	fclose(File);
+	return true;
+}
+
+/* Usage: bench                       runs the benchmarks
+*		  bench --pairs [file.prg...] reports the most frequent opcode pairs of
+*		                              the built-in programs and of the given ones
+*		  bench --reset               reports the cost of a reset and of a snapshot restore
+*		  bench --sparse              reports the footprint of 100000 machines in SparseMems
+*		  bench --pool [--huge]       reports the cost of a short job with and without an InstancePool
+*		  bench --lockstep            reports 32 machines on CPU::Execute against a Lockstep
+*		  bench --cpupool             reports a pass over the registers of many CPUs, in machines and in a CPUPool
+*		  bench --scaling             reports RunBatch from 1 to all hardware threads, pinned and not
+*		  bench --fork                reports a short job on a new machine and through a ForkServer */
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--reset") == 0)
+	{
+		for (u32 Pages : { 0u, 1u, 16u, Mem::NUM_PAGES })
+		{
+			ReportReset(Pages);
+		}
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--pool") == 0)
+	{
+		ReportPool(argc > 2 && std::strcmp(argv[2], "--huge") == 0);
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--fork") == 0)
+	{
+		ReportFork();
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--scaling") == 0)
+	{
+		ReportScaling();
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--cpupool") == 0)
+	{
+		for (u32 Instances : { 64u, 1024u })
+		{
+			ReportCPUPool(Instances);
+		}
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--lockstep") == 0)
+	{
+		ReportLockstep("mixed", MixedPrg, sizeof(MixedPrg));
+		ReportLockstep("test_code", TestCodePrg, sizeof(TestCodePrg));
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--sparse") == 0)
+	{
+		ReportSparse(100000);
+		return 0;
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--pairs") == 0)
+	{
+		ReportPairs("mixed", MixedPrg, sizeof(MixedPrg));
+		ReportPairs("test_code", TestCodePrg, sizeof(TestCodePrg));
+		ReportPairs("idle", IdlePrg, sizeof(IdlePrg));
+		for (int i = 2; i < argc; i++)
+		{
+			std::vector<Byte> Program;
+			if (!ReadFile(argv[i], Program))
+			{
+				printf("Cannot read %s\n", argv[i]);
+				return 1;
+			}
+			ReportPairs(argv[i], Program.data(), static_cast<u32>(Program.size()));
+		}
+		return 0;
+	}
+
+	for (Engine engine : { Engine::Interpreter, Engine::Cached, Engine::Jit })
+	{
+		RunBenchmark("mixed", MixedPrg, sizeof(MixedPrg), engine);
+	}
+	for (Engine engine : { Engine::Interpreter, Engine::Cached, Engine::Jit })
+	{
+		RunBenchmark("test_code", TestCodePrg, sizeof(TestCodePrg), engine);
+	}
+	for (Engine engine : { Engine::Interpreter, Engine::Cached, Engine::Jit })
+	{
+		RunBenchmark("idle", IdlePrg, sizeof(IdlePrg), engine);
+	}
+	return 0;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <random>
+#include "pch.h"
+#include "main_6502.h"
+/* aot_test_program.prg through 6502_cpu_emulator_AOT, see SetUp for the program */
+#include "6502AotTestProgram.h"
+
+using namespace m6502;
+
+class M6502AotTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+	Byte Rom[Mem::PAGE_SIZE] = {};
+
+	/* LDX #$00 / loop: INX, STX $0200, TXA, CLC, ADC #$03, STA $100E, LDY #$00, STY $0201, JMP loop
+	*	at $1000, the STA patches the operand of the LDY that follows it */
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+		static const Byte Program[] = { 0x00, 0x10,
+			CPU::INS_LDX_IM, 0x00,
+			CPU::INS_INX,
+			CPU::INS_STX_ABS, 0x00, 0x02,
+			CPU::INS_TXA,
+			CPU::INS_CLC,
+			CPU::INS_ADC_IM, 0x03,
+			CPU::INS_STA_ABS, 0x0E, 0x10,
+			CPU::INS_LDY_IM, 0x00,
+			CPU::INS_STY_ABS, 0x01, 0x02,
+			CPU::INS_JMP_ABS, 0x02, 0x10 };
+		cpu.LoadPrg(Program, sizeof(Program), mem);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+};
+
+TEST_F(M6502AotTest, TranslatedCodeRunsLikeTheInterpreter)
+{
+	// Given:
+	CPU cpuCopy = cpu;
+	Mem memCopy = mem;
+
+	// When:
+	const s32 Translated = Run_AotTestProgram(cpu, mem, 50);
+	const s32 Interpreted = cpuCopy.Execute(50, memCopy);
+
+	// Then:
+	EXPECT_EQ(Translated, Interpreted);
+	EXPECT_EQ(cpu.PC, cpuCopy.PC);
+	EXPECT_EQ(cpu.X, cpuCopy.X);
+	EXPECT_EQ(mem[0x0200], memCopy[0x0200]);
+}
+
+TEST_F(M6502AotTest, TranslatedCodeMatchesTheInterpreterForAnyBudget)
+{
+	// Given:
+	CPU cpuCopy = cpu;
+	Mem memCopy = mem;
+	std::mt19937 Random(6502);
+	std::uniform_int_distribution<s32> Budget(1, 40);
+
+	for (u32 i = 0; i < 20000; i++)
+	{
+		// When:
+		const s32 Cycles = Budget(Random);
+		const s32 Translated = Run_AotTestProgram(cpu, mem, Cycles);
+		const s32 Interpreted = cpuCopy.Execute(Cycles, memCopy);
+
+		// Then:
+		ASSERT_EQ(Translated, Interpreted) << "budget " << i;
+		ASSERT_EQ(cpu.PC, cpuCopy.PC) << "budget " << i;
+		ASSERT_EQ(cpu.A, cpuCopy.A) << "budget " << i;
+		ASSERT_EQ(cpu.X, cpuCopy.X) << "budget " << i;
+		ASSERT_EQ(cpu.Y, cpuCopy.Y) << "budget " << i;
+		ASSERT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg) << "budget " << i;
+	}
+	EXPECT_EQ(std::memcmp(mem.Data, memCopy.Data, Mem::MAX_MEM), 0);
+}
+
+TEST_F(M6502AotTest, ARomMappedOverTheProgramRunsInstead)
+{
+	// Given:
+	Rom[0x00] = CPU::INS_LDA_IM;
+	Rom[0x01] = 0x02;
+	Rom[0x02] = CPU::INS_JMP_ABS;
+	Rom[0x03] = 0x00;
+	Rom[0x04] = 0x10;
+	mem.MapRom(0x10, 1, Rom);
+
+	// When:
+	Run_AotTestProgram(cpu, mem, 50);
+
+	// Then:
+	EXPECT_EQ(cpu.A, 0x02);
+	EXPECT_EQ(cpu.X, 0x00);
+}
@@ -0,0 +1,77 @@
+/* Generated by 6502_cpu_emulator_AOT from aot_test_program.prg, do not edit.
+*	m6502::s32 Run_AotTestProgram(m6502::CPU& cpu, m6502::Mem& memory, m6502::s32 Cycles);
+*	runs the program like CPU::Execute, @return the number of cycles that were used */
+#include <cstring>
+#include "opcodes_6502.h"
+
+namespace
+{
+	using namespace m6502;
+
+	constexpr Word LOAD_ADDRESS = 0x1000;
+
+	const Byte Image[] = {
+		0xA2, 0x00, 0xE8, 0x8E, 0x00, 0x02, 0x8A, 0x18, 0x69, 0x03, 0x8D, 0x0E, 0x10, 0xA0, 0x00, 0x8C,
+		0x01, 0x02, 0x4C, 0x02, 0x10,
+	};
+
+	/* @return true if the CPU still fetches the translated bytes at Address from RAM */
+	inline bool Unmodified(const Mem& memory, Word Address, u32 Bytes)
+	{
+		return memory.ReadsRam(Address) && memory.ReadsRam(static_cast<Word>(Address + Bytes - 1)) &&
+			std::memcmp(&memory.Data[Address], &Image[Address - LOAD_ADDRESS], Bytes) == 0;
+	}
+}
+
+m6502::s32 Run_AotTestProgram(m6502::CPU& cpu, m6502::Mem& memory, m6502::s32 Cycles)
+{
+	using namespace m6502;
+	const s32 CycleRequested = Cycles;
+	cpu.UnpackStatus();
+
+Dispatch:
+	if (Cycles <= 0) goto Done;
+	switch (cpu.PC)
+	{
+	case 0x1000: goto L_1000;
+	case 0x1002: goto L_1002;
+	default: break;
+	}
+Fallback:
+	if (Cycles <= 0) goto Done;
+	Cycles -= cpu.Interpret(1, memory);
+	goto Dispatch;
+
+L_1000:
+	if (!Unmodified(memory, 0x1000, 2)) goto Fallback;
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1002; Cycles -= 2; Ops::Op_LDX_IM(cpu, Cycles, memory, 0x0000);	// $1000 LDX
+	goto L_1002;
+
+L_1002:
+	if (!Unmodified(memory, 0x1002, 19)) goto Fallback;
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1003; Cycles -= 2; Ops::Op_INX(cpu, Cycles, memory, 0x0000);	// $1002 INX
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1006; Cycles -= 4; Ops::Op_STX_ABS(cpu, Cycles, memory, 0x0200);	// $1003 STX
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1007; Cycles -= 2; Ops::Op_TXA(cpu, Cycles, memory, 0x0000);	// $1006 TXA
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1008; Cycles -= 2; Ops::Op_CLC(cpu, Cycles, memory, 0x0000);	// $1007 CLC
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x100A; Cycles -= 2; Ops::Op_ADC_IM(cpu, Cycles, memory, 0x0003);	// $1008 ADC
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x100D; Cycles -= 4; Ops::Op_STA_ABS(cpu, Cycles, memory, 0x100E);	// $100A STA
+	if (!Unmodified(memory, 0x100D, 8)) goto Dispatch;
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x100F; Cycles -= 2; Ops::Op_LDY_IM(cpu, Cycles, memory, 0x0000);	// $100D LDY
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1012; Cycles -= 4; Ops::Op_STY_ABS(cpu, Cycles, memory, 0x0201);	// $100F STY
+	if (Cycles <= 0) goto Done;
+	cpu.PC = 0x1015; Cycles -= 3; Ops::Op_JMP_ABS(cpu, Cycles, memory, 0x1002);	// $1012 JMP
+	goto L_1002;
+
+Done:
+	cpu.PackStatus();
+	return CycleRequested - Cycles;
+}
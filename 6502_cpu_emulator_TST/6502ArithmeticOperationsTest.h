@@ -551,4 +551,84 @@ TEST_F(M6502ArithmeticOperationsTest, SBCImmediateCanSubtractSettingZeroFlag)
 	EXPECT_FALSE(cpu.PS.Flags.V);
 	EXPECT_TRUE(cpu.PS.Flags.Z);
 	EXPECT_TRUE(cpu.PS.Flags.C);
-}
\ No newline at end of file
+}
+
+TEST_F(M6502ArithmeticOperationsTest, SBC_ZPCanSubtractWithoutBorrow)
+{
+	// Given:
+	cpu.Reset(mem, 0xFF00);
+	cpu.A = 0x05;
+	mem[0xFF00] = CPU::INS_SBC_ZP;
+	mem[0xFF01] = 0x80;
+	mem[AddrZeroPage(0xFF01)] = 0x02;
+	cpu.PS.Flags.N = true;
+	cpu.PS.Flags.Z = true;
+	cpu.PS.Flags.C = true;
+	const s32 EXPECTED_CYCLES = 3;
+	CpuMakeCopy();
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(EXPECTED_CYCLES, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
+	EXPECT_EQ(cpu.A, 0x03);
+	EXPECT_FALSE(cpu.PS.Flags.N);
+	EXPECT_FALSE(cpu.PS.Flags.Z);
+	EXPECT_TRUE(cpu.PS.Flags.C);
+}
+
+TEST_F(M6502ArithmeticOperationsTest, SBC_ABSXPageCrossCanSubtractWithBorrow)
+{
+	// Given:
+	cpu.Reset(mem, 0xFF00);
+	cpu.A = 0x05;
+	cpu.X = 0xFF;
+	mem[0xFF00] = CPU::INS_SBC_ABSX;
+	mem[0xFF01] = 0x02;
+	mem[0xFF02] = 0x80;
+	mem[AddrAbsoluteOffset(0xFF01, &CPU::X)] = 0x02;
+	cpu.PS.Flags.N = true;
+	cpu.PS.Flags.Z = true;
+	cpu.PS.Flags.C = false;
+	const s32 EXPECTED_CYCLES = 5;
+	CpuMakeCopy();
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(EXPECTED_CYCLES, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
+	EXPECT_EQ(cpu.A, 0x02);
+	EXPECT_FALSE(cpu.PS.Flags.N);
+	EXPECT_FALSE(cpu.PS.Flags.Z);
+	EXPECT_TRUE(cpu.PS.Flags.C);
+}
+
+TEST_F(M6502ArithmeticOperationsTest, SBC_INYCanSubtractSettingNegativeFlag)
+{
+	// Given:
+	cpu.Reset(mem, 0xFF00);
+	cpu.A = 0x02;
+	cpu.Y = 0x05;
+	mem[0xFF00] = CPU::INS_SBC_INY;
+	mem[0xFF01] = 0x80;
+	mem[0x0080] = 0x00;
+	mem[0x0081] = 0x80;
+	mem[AddrIndirectY(0xFF01)] = 0x05;
+	cpu.PS.Flags.N = false;
+	cpu.PS.Flags.Z = true;
+	cpu.PS.Flags.C = true;
+	const s32 EXPECTED_CYCLES = 5;
+	CpuMakeCopy();
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(EXPECTED_CYCLES, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
+	EXPECT_EQ(cpu.A, 0xFD);
+	EXPECT_TRUE(cpu.PS.Flags.N);
+	EXPECT_FALSE(cpu.PS.Flags.Z);
+	EXPECT_FALSE(cpu.PS.Flags.C);
+}
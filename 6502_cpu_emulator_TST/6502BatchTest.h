@@ -0,0 +1,129 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "batch_6502.h"
+
+using namespace m6502;
+
+class M6502BatchTest : public testing::Test
+{
+public:
+	/* Adds X to A 100 times, stores A at $2000 and loops */
+	Byte Prg[16] = { 0x00, 0x10,
+					CPU::INS_LDY_IM, 100,
+					CPU::INS_CLC,
+					CPU::INS_TXA,
+					CPU::INS_ADC_ZP, 0x90,
+					CPU::INS_STA_ZP, 0x90,
+					CPU::INS_DEY,
+					CPU::INS_BNE, 0xF7,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+
+	virtual void SetUp()
+	{
+
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	BatchJob MakeJob(Byte X, s32 Cycles)
+	{
+		BatchJob Job;
+		Job.Program = RomImage::Copy(Prg, sizeof(Prg));
+		Job.Start.PC = 0x1000;
+		Job.Start.X = X;
+		Job.Cycles = Cycles;
+		Job.Ranges.push_back(BatchRange{ 0x0090, 1 });
+		return Job;
+	}
+};
+
+TEST_F(M6502BatchTest, JobsEndAsIfEachRanAloneOnOneCPU)
+{
+	// Given:
+	std::vector<BatchJob> Jobs;
+	for (u32 i = 0; i < 40; i++)
+	{
+		Jobs.push_back(MakeJob(static_cast<Byte>(i), 500 + i * 97));
+	}
+
+	// When:
+	std::vector<BatchResult> Results = RunBatch(Jobs, 4);
+
+	// Then:
+	ASSERT_EQ(Results.size(), Jobs.size());
+	for (u32 i = 0; i < Jobs.size(); i++)
+	{
+		Mem mem;
+		CPU cpu;
+		cpu.Reset(mem, 0x1000);
+		cpu.LoadPrg(Prg, sizeof(Prg), mem);
+		cpu.X = static_cast<Byte>(i);
+		const s32 Cycles = cpu.Execute(Jobs[i].Cycles, mem);
+		EXPECT_FALSE(Results[i].Failed);
+		EXPECT_EQ(Results[i].CyclesUsed, Cycles);
+		EXPECT_EQ(Results[i].End.PC, cpu.PC);
+		EXPECT_EQ(Results[i].End.A, cpu.A);
+		EXPECT_EQ(Results[i].End.Y, cpu.Y);
+		EXPECT_EQ(Results[i].End.PS, cpu.PS.Reg);
+		ASSERT_EQ(Results[i].Ranges.size(), 1u);
+		EXPECT_EQ(Results[i].Ranges[0], std::vector<Byte>{ mem[0x0090] });
+	}
+}
+
+TEST_F(M6502BatchTest, AJobThatFailsDoesNotStopTheOthers)
+{
+	// Given:
+	Byte Bad[] = { 0x00, 0x10, 0x02 };
+	std::vector<BatchJob> Jobs = { MakeJob(1, 1000), MakeJob(2, 1000) };
+	Jobs[0].Program = RomImage::Copy(Bad, sizeof(Bad));
+
+	// When:
+	std::vector<BatchResult> Results = RunBatch(Jobs, 2);
+
+	// Then:
+	EXPECT_TRUE(Results[0].Failed);
+	EXPECT_FALSE(Results[1].Failed);
+	EXPECT_GE(Results[1].CyclesUsed, 1000);
+}
+
+TEST_F(M6502BatchTest, RangesPastTheEndOfMemoryAreCut)
+{
+	// Given:
+	std::vector<BatchJob> Jobs = { MakeJob(1, 100) };
+	Jobs[0].Ranges = { BatchRange{ 0xFF00, 0xFFFFFFF0 } };
+
+	// When:
+	std::vector<BatchResult> Results = RunBatch(Jobs, 1);
+
+	// Then:
+	ASSERT_EQ(Results[0].Ranges.size(), 1u);
+	EXPECT_EQ(Results[0].Ranges[0].size(), 0x100u);
+}
+
+TEST_F(M6502BatchTest, PinnedThreadsEndTheJobsTheSame)
+{
+	// Given:
+	std::vector<BatchJob> Jobs;
+	for (u32 i = 0; i < 16; i++)
+	{
+		Jobs.push_back(MakeJob(static_cast<Byte>(i), 300 + i * 51));
+	}
+
+	// When:
+	std::vector<BatchResult> Anywhere = RunBatch(Jobs, 3, BatchPlacement::Any);
+	std::vector<BatchResult> Pinned = RunBatch(Jobs, 3, BatchPlacement::Pinned);
+
+	// Then:
+	for (u32 i = 0; i < Jobs.size(); i++)
+	{
+		EXPECT_FALSE(Pinned[i].Failed);
+		EXPECT_EQ(Pinned[i].CyclesUsed, Anywhere[i].CyclesUsed);
+		EXPECT_EQ(Pinned[i].End.PC, Anywhere[i].End.PC);
+		EXPECT_EQ(Pinned[i].End.A, Anywhere[i].End.A);
+		EXPECT_EQ(Pinned[i].Ranges, Anywhere[i].Ranges);
+	}
+}
@@ -0,0 +1,224 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include "pch.h"
+#include "main_6502.h"
+#include "c64_banking_6502.h"
+#include "jit_6502.h"
+
+using namespace m6502;
+
+class M6502C64BankingTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+	Byte Basic[C64Banking::BASIC_SIZE];
+	Byte Kernal[C64Banking::KERNAL_SIZE];
+	Byte Char[C64Banking::CHAR_SIZE];
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+		for (u32 i = 0; i < C64Banking::BASIC_SIZE; i++)
+		{
+			Basic[i] = 0xBA;
+			Kernal[i] = 0xEE;
+		}
+		for (u32 i = 0; i < C64Banking::CHAR_SIZE; i++)
+		{
+			Char[i] = 0xC4;
+		}
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	/* @return the path of a new file holding Size bytes of Bytes */
+	static std::string WriteRom(const char* Name, const Byte* Bytes, u32 Size)
+	{
+		const std::string Path = testing::TempDir() + Name;
+		FILE* File = fopen(Path.c_str(), "wb");
+		fwrite(Bytes, 1, Size, File);
+		fclose(File);
+		return Path;
+	}
+
+	void LoadCode(const Byte* Code, u32 Size)
+	{
+		for (u32 i = 0; i < Size; i++)
+		{
+			mem[0x1000 + i] = Code[i];
+		}
+	}
+};
+
+TEST_F(M6502C64BankingTest, PowerUpHasBASICKERNALAndIOIn)
+{
+	// Given:
+	CountingDevice Io;
+
+	// When:
+	C64Banking Banking(mem, Basic, Kernal, Char, &Io);
+
+	// Then:
+	EXPECT_EQ(mem.Read(0xA000), 0xBA);
+	EXPECT_EQ(mem.Read(0xFFFF), 0xEE);
+	EXPECT_EQ(mem.Read(0xD012), 0x12);
+	EXPECT_EQ(mem.Read(0x0000), 0x00);
+	EXPECT_EQ(mem.Read(0x0001), C64Banking::INPUT_LINES);
+	EXPECT_TRUE(mem.IsRam(0x0801));
+}
+
+TEST_F(M6502C64BankingTest, WritingThePortSwitchesTheBanks)
+{
+	// Given:
+	C64Banking Banking(mem, Basic, Kernal, Char, nullptr);
+	mem[0xA000] = 0x01;
+	mem[0xD000] = 0x02;
+	mem[0xE000] = 0x03;
+	Byte Code[] = { CPU::INS_LDA_IM, 0x2F,
+					CPU::INS_STA_ZP, 0x00,
+					CPU::INS_LDA_IM, 0x34,		// all RAM
+					CPU::INS_STA_ZP, 0x01,
+					CPU::INS_LDX_ABS, 0x00, 0xA0,
+					CPU::INS_LDY_ABS, 0x00, 0xE0,
+					CPU::INS_LDA_IM, 0x33,		// BASIC, CHAR ROM, KERNAL
+					CPU::INS_STA_ZP, 0x01,
+					CPU::INS_LDA_ABS, 0x00, 0xD0 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	cpu.Execute(2 + 3 + 2 + 3 + 4 + 4 + 2 + 3 + 4, mem);
+
+	// Then:
+	EXPECT_EQ(cpu.X, 0x01);
+	EXPECT_EQ(cpu.Y, 0x03);
+	EXPECT_EQ(cpu.A, 0xC4);
+	EXPECT_EQ(mem.Read(0xA000), 0xBA);
+	EXPECT_EQ(mem.Read(0x0000), 0x2F);
+	EXPECT_EQ(mem.Read(0x0001), 0x33);
+	EXPECT_EQ(mem[0xD000], 0x02);
+}
+
+TEST_F(M6502C64BankingTest, CompiledCodeSeesTheBankItWasNotCompiledFor)
+{
+	// Given:
+	C64Banking Banking(mem, Basic, Kernal, Char, nullptr);
+	Jit jit;
+	mem[0xE000] = 0x03;
+	Byte Code[] = { CPU::INS_LDA_ABS, 0x00, 0xE0,
+					CPU::INS_TAX,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+	LoadCode(Code, sizeof(Code));
+	Banking.Write(0x0000, 0x2F);
+	Banking.Write(0x0001, 0x34);
+	for (u32 i = 0; i < 50; i++)
+	{
+		cpu.Execute(9, mem, jit);
+	}
+	ASSERT_EQ(cpu.X, 0x03);
+	if (Jit::Available())
+	{
+		ASSERT_GT(jit.CompiledBlocks(), 0u);
+	}
+
+	// When:
+	Banking.Write(0x0001, 0x37);
+	cpu.Execute(9, mem, jit);
+
+	// Then:
+	EXPECT_EQ(cpu.X, 0xEE);
+}
+
+TEST_F(M6502C64BankingTest, ZeroPageStoresStayOnTheRAMAndCompile)
+{
+	// Given:
+	C64Banking Banking(mem, Basic, Kernal, Char, nullptr);
+	Jit jit;
+	Byte Code[] = { CPU::INS_LDA_IM, 0x42,
+					CPU::INS_STA_ZP, 0x80,
+					CPU::INS_INC_ZP, 0x81,
+					CPU::INS_STA_ZP, 0x00,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	for (u32 i = 0; i < 50; i++)
+	{
+		cpu.Execute(2 + 3 + 5 + 3 + 3, mem, jit);
+	}
+
+	// Then:
+	EXPECT_TRUE(mem.WritesRam(0x0080));
+	EXPECT_FALSE(mem.WritesRam(0x0000));
+	EXPECT_FALSE(mem.WritesRam(0x0001));
+	EXPECT_EQ(mem[0x0080], 0x42);
+	EXPECT_EQ(mem[0x0081], 50);
+	EXPECT_EQ(Banking.Direction, 0x42);
+	EXPECT_EQ(mem[0x0000], 0x42);
+	if (Jit::Available())
+	{
+		EXPECT_GT(jit.CompiledBlocks(), 0u);
+	}
+}
+
+TEST_F(M6502C64BankingTest, ACopyOfABankedMemoryLeavesTheOriginalAlone)
+{
+	// Given:
+	C64Banking Banking(mem, Basic, Kernal, Char, nullptr);
+	Mem copy(mem);
+
+	// When:
+	copy.Write(0x0080, 0x42);
+	copy.Write(0x0001, 0x34);		// all RAM, if the copy had a port
+
+	// Then:
+	EXPECT_EQ(copy[0x0080], 0x42);
+	EXPECT_EQ(mem[0x0080], 0x00);
+	EXPECT_EQ(copy.Read(0xA000), 0xBA);
+	EXPECT_EQ(mem.Read(0xA000), 0xBA);
+	EXPECT_EQ(mem.Read(0x0001), C64Banking::INPUT_LINES);
+}
+
+TEST_F(M6502C64BankingTest, InstancesShareTheROMFilesMappedOnce)
+{
+	// Given:
+	const std::string BasicPath = WriteRom("m6502_basic.rom", Basic, C64Banking::BASIC_SIZE);
+	const std::string KernalPath = WriteRom("m6502_kernal.rom", Kernal, C64Banking::KERNAL_SIZE);
+	const std::string CharPath = WriteRom("m6502_char.rom", Char, C64Banking::CHAR_SIZE);
+	C64Roms Roms;
+	C64Roms Again;
+	ASSERT_TRUE(Roms.Open(BasicPath.c_str(), KernalPath.c_str(), CharPath.c_str()));
+	ASSERT_TRUE(Again.Open(BasicPath.c_str(), KernalPath.c_str(), CharPath.c_str()));
+	Mem other;
+
+	// When:
+	C64Banking Banking(mem, Roms, nullptr);
+	C64Banking OtherBanking(other, Again, nullptr);
+
+	// Then:
+	EXPECT_EQ(Roms.Kernal, Again.Kernal);
+	EXPECT_TRUE(Roms.Kernal->Mapped());
+	EXPECT_EQ(mem.Read(0xA000), 0xBA);
+	EXPECT_EQ(other.Read(0xFFFF), 0xEE);
+	EXPECT_EQ(mem.ReadPages[0xE0], other.ReadPages[0xE0]);
+}
+
+TEST_F(M6502C64BankingTest, ROMFilesOfTheWrongSizeAreRefused)
+{
+	// Given:
+	const std::string BasicPath = WriteRom("m6502_basic.rom", Basic, C64Banking::BASIC_SIZE);
+	const std::string CharPath = WriteRom("m6502_char.rom", Char, C64Banking::CHAR_SIZE);
+	C64Roms Roms;
+
+	// When:
+	const bool Opened = Roms.Open(BasicPath.c_str(), CharPath.c_str(), CharPath.c_str());
+
+	// Then:
+	EXPECT_FALSE(Opened);
+	EXPECT_FALSE(Roms.Kernal);
+	EXPECT_FALSE(RomImage::Open((testing::TempDir() + "m6502_missing.rom").c_str()));
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "cpu_pool_6502.h"
+
+using namespace m6502;
+
+class M6502CPUPoolTest : public testing::Test
+{
+public:
+	/* Adds X to A 100 times, stores A at $90 and loops */
+	Byte Prg[16] = { 0x00, 0x10,
+					CPU::INS_LDY_IM, 100,
+					CPU::INS_CLC,
+					CPU::INS_TXA,
+					CPU::INS_ADC_ZP, 0x90,
+					CPU::INS_STA_ZP, 0x90,
+					CPU::INS_DEY,
+					CPU::INS_BNE, 0xF7,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+
+	virtual void SetUp()
+	{
+
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+};
+
+TEST_F(M6502CPUPoolTest, AViewRunsLikeTheCPUItStandsFor)
+{
+	// Given:
+	CPUPool Pool;
+	Mem PoolMem, CpuMem;
+	CPU cpu;
+	cpu.Reset(CpuMem, 0x1000);
+	cpu.LoadPrg(Prg, sizeof(Prg), CpuMem);
+	cpu.X = 3;
+	Pool.Add(CPU());
+	CPUView View = Pool[Pool.Add(CPU())];
+	View.Reset(PoolMem, 0x1000);
+	cpu.LoadPrg(Prg, sizeof(Prg), PoolMem);
+	View.X = 3;
+
+	// When:
+	const s32 Used = View.Execute(1234, PoolMem);
+	const s32 Expected = cpu.Execute(1234, CpuMem);
+
+	// Then:
+	EXPECT_EQ(Used, Expected);
+	EXPECT_EQ(View.CyclesRun, static_cast<u64>(Expected));
+	EXPECT_EQ(View.PC, cpu.PC);
+	EXPECT_EQ(View.SP, cpu.SP);
+	EXPECT_EQ(View.A, cpu.A);
+	EXPECT_EQ(View.Y, cpu.Y);
+	EXPECT_EQ(View.PS.Reg, cpu.PS.Reg);
+	EXPECT_EQ(PoolMem[0x0090], CpuMem[0x0090]);
+	EXPECT_EQ(Pool.PC[0], CPU().PC);
+}
+
+TEST_F(M6502CPUPoolTest, EachRegisterIsOneArray)
+{
+	// Given:
+	CPUPool Pool;
+	CPU cpu;
+	for (u32 i = 0; i < 100; i++)
+	{
+		cpu.PC = static_cast<Word>(0x1000 + i);
+		cpu.A = static_cast<Byte>(i);
+		cpu.PS.Reg = static_cast<Byte>(i * 3);
+		EXPECT_EQ(Pool.Add(cpu), i);
+	}
+
+	// When:
+	Pool[42].A = 0xAA;
+	Pool[43].PS.Flags.C = 0;
+
+	// Then:
+	EXPECT_EQ(Pool.Size(), 100u);
+	EXPECT_EQ(&Pool.A[99] - &Pool.A[0], 99);
+	EXPECT_EQ(Pool.A[42], 0xAA);
+	EXPECT_EQ(Pool.PC[43], 0x1000 + 43);
+	EXPECT_EQ(Pool.PS[43].Reg, (43 * 3) & 0xFE);
+	CPU Copy;
+	Pool[43].Get(Copy);
+	EXPECT_EQ(Copy.PC, 0x1000 + 43);
+	EXPECT_EQ(Copy.Status.C, 0);
+	EXPECT_EQ(Copy.Status.V, ((43 * 3) >> 6) & 1);
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "decode_cache_6502.h"
+
+using namespace m6502;
+
+class M6502DecodeCacheTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+	CPU cpuCopy;
+	DecodeCache Cache;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	void CpuMakeCopy()
+	{
+		cpuCopy = cpu;
+	}
+
+};
+
+TEST_F(M6502DecodeCacheTest, CachedExecutionMatchesTheInterpreter)
+{
+	// Given:
+	Byte prg[] = { 0x00, 0x10, 0xa9, 0xff, 0x85, 0x90, 0x8d,
+					0x00, 0x80, 0x49, 0xcc, 0x4c, 0x02, 0x10 };
+	Mem memCopy;
+	cpu.PC = cpu.LoadPrg(prg, 14, mem);
+	memCopy = mem;
+	CpuMakeCopy();
+
+	// When:
+	s32 CachedCycles = 0;
+	s32 InterpretedCycles = 0;
+	for (u32 i = 0; i < 100; i++)
+	{
+		CachedCycles += cpu.Execute(7, mem, Cache);
+		InterpretedCycles += cpuCopy.Execute(7, memCopy);
+	}
+
+	// Then:
+	EXPECT_EQ(CachedCycles, InterpretedCycles);
+	EXPECT_EQ(cpu.PC, cpuCopy.PC);
+	EXPECT_EQ(cpu.A, cpuCopy.A);
+	EXPECT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg);
+	EXPECT_EQ(mem[0x0090], memCopy[0x0090]);
+	EXPECT_EQ(mem[0x8000], memCopy[0x8000]);
+}
+
+TEST_F(M6502DecodeCacheTest, SelfModifyingCodeInTheSameBlockIsSeen)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_LDA_IM;
+	mem[0x1001] = 0x42;
+	mem[0x1002] = CPU::INS_STA_ABS;		// patches the operand of the next LDA
+	mem[0x1003] = 0x06;
+	mem[0x1004] = 0x10;
+	mem[0x1005] = CPU::INS_LDA_IM;
+	mem[0x1006] = 0x00;
+	constexpr s32 EXPECTED_CYCLES = 2 + 4 + 2;
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(EXPECTED_CYCLES, mem, Cache);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
+	EXPECT_EQ(cpu.A, 0x42);
+	EXPECT_FALSE(cpu.PS.Flags.Z);
+}
+
+TEST_F(M6502DecodeCacheTest, WritesFromTheHostInvalidateDecodedBlocks)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_LDA_IM;
+	mem[0x1001] = 0x01;
+	mem[0x1002] = CPU::INS_JMP_ABS;
+	mem[0x1003] = 0x00;
+	mem[0x1004] = 0x10;
+	cpu.Execute(5, mem, Cache);
+	EXPECT_EQ(cpu.A, 0x01);
+
+	// When:
+	mem[0x1001] = 0x02;
+	cpu.Execute(5, mem, Cache);
+
+	// Then:
+	EXPECT_EQ(cpu.A, 0x02);
+}
+
+TEST_F(M6502DecodeCacheTest, ReadsFromTheHostKeepDecodedBlocks)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_LDA_IM;
+	mem[0x1001] = 0x01;
+	mem[0x1002] = CPU::INS_JMP_ABS;
+	mem[0x1003] = 0x00;
+	mem[0x1004] = 0x10;
+	cpu.Execute(5, mem, Cache);
+	const u32 Version = mem.PageVersion[0x10];
+
+	// When:
+	const Byte Operand = mem[0x1001];
+
+	// Then:
+	EXPECT_EQ(Operand, 0x01);
+	EXPECT_EQ(mem.PageVersion[0x10], Version);
+}
+
+TEST_F(M6502DecodeCacheTest, ACacheMovedToAnotherMemoryDoesNotReuseBlocks)
+{
+	// Given:
+	Mem otherMem;
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_LDA_IM;
+	mem[0x1001] = 0x01;
+	cpu.Execute(2, mem, Cache);
+	EXPECT_EQ(cpu.A, 0x01);
+
+	cpu.Reset(otherMem, 0x1000);
+	otherMem[0x1000] = CPU::INS_LDX_IM;
+	otherMem[0x1001] = 0x07;
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(2, otherMem, Cache);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, 2);
+	EXPECT_EQ(cpu.A, 0x00);
+	EXPECT_EQ(cpu.X, 0x07);
+}
+
+TEST_F(M6502DecodeCacheTest, BudgetIsHonouredInsideABlock)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_INX;
+	mem[0x1001] = CPU::INS_INX;
+	mem[0x1002] = CPU::INS_INX;
+	mem[0x1003] = CPU::INS_INX;
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(4, mem, Cache);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, 4);
+	EXPECT_EQ(cpu.X, 2);
+	EXPECT_EQ(cpu.PC, 0x1002);
+}
+
+TEST_F(M6502DecodeCacheTest, FusedInstructionsMatchTheInterpreterForEveryBudget)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	Byte Code[] = { CPU::INS_LDX_IM, 0x00,
+					CPU::INS_CLC,						// CLC/ADC
+					CPU::INS_ADC_IM, 0x03,
+					CPU::INS_STA_ZP, 0x90,
+					CPU::INS_LDA_IM, 0x05,				// LDA/STA
+					CPU::INS_STA_ABS, 0x00, 0x20,
+					CPU::INS_CMP_IM, 0x05,				// CMP/BEQ
+					CPU::INS_BEQ, 0x00,
+					CPU::INS_INX,						// INX/CPX/BNE
+					CPU::INS_CMX_IM, 0x10,
+					CPU::INS_BNE, 0xED,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+	for (u32 i = 0; i < sizeof(Code); i++)
+	{
+		mem[0x1000 + i] = Code[i];
+	}
+	Mem memCopy = mem;
+	CpuMakeCopy();
+
+	for (s32 Budget = 1; Budget < 60; Budget++)
+	{
+		// When:
+		const s32 CachedCycles = cpu.Execute(Budget, mem, Cache);
+		const s32 InterpretedCycles = cpuCopy.Execute(Budget, memCopy);
+
+		// Then:
+		ASSERT_EQ(CachedCycles, InterpretedCycles);
+		ASSERT_EQ(cpu.PC, cpuCopy.PC);
+		ASSERT_EQ(cpu.A, cpuCopy.A);
+		ASSERT_EQ(cpu.X, cpuCopy.X);
+		ASSERT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg);
+		ASSERT_EQ(mem[0x0090], memCopy[0x0090]);
+		ASSERT_EQ(mem[0x2000], memCopy[0x2000]);
+	}
+}
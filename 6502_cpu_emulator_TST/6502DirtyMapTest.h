@@ -0,0 +1,129 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "jit_6502.h"
+
+using namespace m6502;
+
+class M6502DirtyMapTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	void LoadCode(const Byte* Code, u32 Size)
+	{
+		for (u32 i = 0; i < Size; i++)
+		{
+			mem[0x1000 + i] = Code[i];
+		}
+		mem.ClearDirty();
+	}
+};
+
+#if M6502_DIRTY_MAP
+
+TEST_F(M6502DirtyMapTest, CPUWritesAndPushesMarkTheirPagesAndBytes)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_LDA_IM, 0x42,
+					CPU::INS_STA_ABS, 0x10, 0x04,
+					CPU::INS_PHA,
+					CPU::INS_JSR, 0x00, 0x20 };
+	LoadCode(Code, sizeof(Code));
+	mem[0x2000] = CPU::INS_RTS;
+	mem.ClearDirty(0x20, 1);
+
+	// When:
+	cpu.Execute(2 + 4 + 3 + 6, mem);
+
+	// Then:
+	EXPECT_TRUE(mem.PageDirty(0x04));
+	EXPECT_TRUE(mem.ByteDirty(0x0410));
+	EXPECT_FALSE(mem.ByteDirty(0x0411));
+	EXPECT_TRUE(mem.ByteDirty(0x01FF));
+	EXPECT_TRUE(mem.ByteDirty(0x01FE));
+	EXPECT_TRUE(mem.ByteDirty(0x01FD));
+	EXPECT_FALSE(mem.PageDirty(0x10));
+	EXPECT_FALSE(mem.PageDirty(0x20));
+	EXPECT_EQ(mem.NextDirtyPage(0), 0x01u);
+	EXPECT_EQ(mem.NextDirtyPage(0x02), 0x04u);
+	EXPECT_EQ(mem.NextDirtyPage(0x05), Mem::NUM_PAGES);
+}
+
+TEST_F(M6502DirtyMapTest, RangesAndClearingFollowTheWrites)
+{
+	// Given:
+	mem.ClearDirty();
+
+	// When:
+	mem.Write(0x07E7, 0x01);
+
+	// Then:
+	EXPECT_TRUE(mem.RangeDirty(0x0400, 1000));
+	EXPECT_FALSE(mem.RangeDirty(0x0400, 999));
+	EXPECT_FALSE(mem.RangeDirty(0x07E8, 0x100));
+
+	// When:
+	mem.ClearDirty(0x04, 4);
+
+	// Then:
+	EXPECT_FALSE(mem.RangeDirty(0x0400, 1000));
+	EXPECT_EQ(mem.NextDirtyPage(0), Mem::NUM_PAGES);
+}
+
+TEST_F(M6502DirtyMapTest, ReadsFromTheHostLeaveTheMapClean)
+{
+	// Given:
+	mem[0x0400] = 0x42;
+	mem.ClearDirty();
+
+	// When:
+	const Byte Value = mem[0x0400];
+
+	// Then:
+	EXPECT_EQ(Value, 0x42);
+	EXPECT_FALSE(mem.PageDirty(0x04));
+	EXPECT_FALSE(mem.ByteDirty(0x0400));
+}
+
+TEST_F(M6502DirtyMapTest, CompiledStoresMarkTheirPagesAndBytes)
+{
+	// Given:
+	Jit jit;
+	Byte Code[] = { CPU::INS_INX,
+					CPU::INS_STX_ABS, 0x00, 0x30,
+					CPU::INS_INC_ZP, 0x80,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+	LoadCode(Code, sizeof(Code));
+	for (u32 i = 0; i < 50; i++)
+	{
+		cpu.Execute(14, mem, jit);
+	}
+	if (Jit::Available())
+	{
+		ASSERT_GT(jit.CompiledBlocks(), 0u);
+	}
+	mem.ClearDirty();
+
+	// When:
+	cpu.Execute(14, mem, jit);
+
+	// Then:
+	EXPECT_TRUE(mem.ByteDirty(0x3000));
+	EXPECT_TRUE(mem.ByteDirty(0x0080));
+	EXPECT_FALSE(mem.ByteDirty(0x3001));
+	EXPECT_EQ(mem.NextDirtyPage(1), 0x30u);
+}
+
+#endif
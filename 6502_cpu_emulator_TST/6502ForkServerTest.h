@@ -0,0 +1,232 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "fork_server_6502.h"
+#include "pool_6502.h"
+#include "c64_banking_6502.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+using namespace m6502;
+
+class M6502ForkServerTest : public testing::Test
+{
+public:
+	/* Adds X to A 100 times, stores A at $90 and loops */
+	Byte Prg[16] = { 0x00, 0x10,
+					CPU::INS_LDY_IM, 100,
+					CPU::INS_CLC,
+					CPU::INS_TXA,
+					CPU::INS_ADC_ZP, 0x90,
+					CPU::INS_STA_ZP, 0x90,
+					CPU::INS_DEY,
+					CPU::INS_BNE, 0xF7,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+
+	Machine Ready;
+
+	virtual void SetUp()
+	{
+		Ready.cpu.Reset(Ready.memory);
+		Ready.cpu.PC = Ready.cpu.LoadPrg(Prg, sizeof(Prg), Ready.memory);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	/* @return the result line of a CPU run from Ready with X, like the server prints it */
+	std::string Expected(const char* Id, Byte X, s32 Cycles)
+	{
+		Machine Copy;
+		Copy.cpu = Ready.cpu;
+		Copy.memory = Ready.memory;
+		Copy.cpu.X = X;
+		const s32 Used = Copy.cpu.Execute(Cycles, Copy.memory);
+		char Line[128];
+		snprintf(Line, sizeof(Line), "id=%s A=%02X X=%02X Y=%02X SP=%02X PC=%04X PS=%02X cycles=%d %02X\n", Id,
+			Copy.cpu.A, Copy.cpu.X, Copy.cpu.Y, Copy.cpu.SP, Copy.cpu.PC, Copy.cpu.PS.Reg, Used, Copy.memory.Read(0x0090));
+		return Line;
+	}
+
+#if defined(__unix__) || defined(__APPLE__)
+	/* @return what a ForkServer of machine with Children workers answers to Lines */
+	static std::string Serve(Machine& machine, u32 Children, const std::string& Lines)
+	{
+		int Jobs[2], Results[2];
+		if (pipe(Jobs) != 0 || pipe(Results) != 0)
+		{
+			return "no pipe";
+		}
+		if (write(Jobs[1], Lines.data(), Lines.size()) != static_cast<ssize_t>(Lines.size()))
+		{
+			return "no write";
+		}
+		close(Jobs[1]);
+		const bool Served = ForkServer(machine, Children).Serve(Jobs[0], Results[1]);
+		close(Results[1]);
+		std::string Output;
+		char Buffer[512];
+		ssize_t Read;
+		while ((Read = read(Results[0], Buffer, sizeof(Buffer))) > 0)
+		{
+			Output.append(Buffer, Read);
+		}
+		close(Jobs[0]);
+		close(Results[0]);
+		return Served ? Output : "not served";
+	}
+#endif
+};
+
+TEST_F(M6502ForkServerTest, AJobLineRunsFromTheReadyMachine)
+{
+	// Given:
+	const std::string Line = "id=7 X=03 cycles=500 dump=0090:1";
+
+	// When:
+	const std::string Result = ForkServer::Run(Line, Ready.cpu, Ready.memory);
+
+	// Then:
+	SetUp();
+	EXPECT_EQ(Result, Expected("7", 3, 500));
+	EXPECT_EQ(ForkServer::Run("X=300", Ready.cpu, Ready.memory), "error bad value X=300\n");
+	EXPECT_EQ(ForkServer::Run("Z=1", Ready.cpu, Ready.memory), "error unknown key Z\n");
+	const std::string Cut = ForkServer::Run("cycles=1 dump=FFFE:4294967295", Ready.cpu, Ready.memory);
+	EXPECT_EQ(Cut.size() - Cut.rfind(' '), 1 + 2 * 2 + 1u);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_F(M6502ForkServerTest, JobsRunInWorkersAndAnswerInOrder)
+{
+	// Given:
+	int Jobs[2], Results[2];
+	ASSERT_EQ(pipe(Jobs), 0);
+	ASSERT_EQ(pipe(Results), 0);
+	const std::string Lines = "id=a X=01 cycles=700 dump=0090:1\nnot=a-key\n\nid=b X=05 cycles=1300 dump=0090:1";
+	ASSERT_EQ(write(Jobs[1], Lines.data(), Lines.size()), static_cast<ssize_t>(Lines.size()));
+	close(Jobs[1]);
+
+	// When:
+	ForkServer Server(Ready, 2);
+	const bool Served = Server.Serve(Jobs[0], Results[1]);
+	close(Results[1]);
+
+	// Then:
+	EXPECT_TRUE(Served);
+	std::string Output;
+	char Buffer[512];
+	ssize_t Read;
+	while ((Read = read(Results[0], Buffer, sizeof(Buffer))) > 0)
+	{
+		Output.append(Buffer, Read);
+	}
+	close(Jobs[0]);
+	close(Results[0]);
+	EXPECT_EQ(Output, Expected("a", 1, 700) + "error unknown key not\n" + Expected("b", 5, 1300));
+	EXPECT_EQ(Ready.memory[0x0090], 0);		// the jobs wrote to their copies
+}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_F(M6502ForkServerTest, AWorkerStartsEveryJobFromTheReadyMachine)
+{
+	// Given:
+	int Jobs[2], Results[2];
+	ASSERT_EQ(pipe(Jobs), 0);
+	ASSERT_EQ(pipe(Results), 0);
+	const std::string Lines = "id=a X=01 cycles=700 dump=0090:1\nX=05 Y=zz\nid=b X=01 cycles=700 dump=0090:1\n"
+		"id=c cycles=900 dump=0090:1\n";
+	ASSERT_EQ(write(Jobs[1], Lines.data(), Lines.size()), static_cast<ssize_t>(Lines.size()));
+	close(Jobs[1]);
+
+	// When:
+	ForkServer Server(Ready, 1);
+	const bool Served = Server.Serve(Jobs[0], Results[1]);
+	close(Results[1]);
+
+	// Then:
+	EXPECT_TRUE(Served);
+	std::string Output;
+	char Buffer[512];
+	ssize_t Read;
+	while ((Read = read(Results[0], Buffer, sizeof(Buffer))) > 0)
+	{
+		Output.append(Buffer, Read);
+	}
+	close(Jobs[0]);
+	close(Results[0]);
+	EXPECT_EQ(Output, Expected("a", 1, 700) + "error bad value Y=zz\n" + Expected("b", 1, 700)
+		+ Expected("c", Ready.cpu.X, 900));
+}
+
+TEST_F(M6502ForkServerTest, AJobThatSwitchesBanksLeavesTheNextOneTheReadyBanks)
+{
+	// Given:
+	static Byte Basic[0x2000], Kernal[0x2000], Char[0x1000];
+	Basic[0] = 0x42;
+	Machine Banked;
+	Banked.cpu.Reset(Banked.memory);
+	C64Banking Banks(Banked.memory, Basic, Kernal, Char, nullptr);
+	// switches BASIC out and loops, then at $100B reads $A000 to $91
+	Byte Switch[] = { 0x00, 0x10,
+					CPU::INS_LDA_IM, 0x2F, CPU::INS_STA_ZP, 0x00,
+					CPU::INS_LDA_IM, 0x35, CPU::INS_STA_ZP, 0x01,
+					CPU::INS_JMP_ABS, 0x08, 0x10,
+					CPU::INS_LDA_ABS, 0x00, 0xA0, CPU::INS_STA_ZP, 0x91,
+					CPU::INS_JMP_ABS, 0x10, 0x10 };
+	Banked.cpu.PC = Banked.cpu.LoadPrg(Switch, sizeof(Switch), Banked.memory);
+	int Jobs[2], Results[2];
+	ASSERT_EQ(pipe(Jobs), 0);
+	ASSERT_EQ(pipe(Results), 0);
+	const std::string Lines = "cycles=40\nPC=100B cycles=10 dump=0091:1\n";
+	ASSERT_EQ(write(Jobs[1], Lines.data(), Lines.size()), static_cast<ssize_t>(Lines.size()));
+	close(Jobs[1]);
+
+	// When:
+	const bool Served = ForkServer(Banked, 1).Serve(Jobs[0], Results[1]);
+	close(Results[1]);
+
+	// Then:
+	EXPECT_TRUE(Served);
+	std::string Output;
+	char Buffer[512];
+	ssize_t Read;
+	while ((Read = read(Results[0], Buffer, sizeof(Buffer))) > 0)
+	{
+		Output.append(Buffer, Read);
+	}
+	close(Jobs[0]);
+	close(Results[0]);
+	EXPECT_EQ(Output.substr(Output.rfind(' ') + 1), "42\n");
+}
+
+TEST_F(M6502ForkServerTest, AJobThatWritesThePortLeavesTheNextOneTheReadyPort)
+{
+	// Given:
+	static Byte Basic[0x2000], Kernal[0x2000], Char[0x1000];
+	Machine Banked;
+	Banked.cpu.Reset(Banked.memory);
+	C64Banking Banks(Banked.memory, Basic, Kernal, Char, nullptr);
+	// writes $3F to the port, its lines are inputs so the banks stay; then at $1007 makes them outputs
+	Byte Write[] = { 0x00, 0x10,
+					CPU::INS_LDA_IM, 0x3F, CPU::INS_STA_ZP, 0x01,
+					CPU::INS_JMP_ABS, 0x04, 0x10,
+					CPU::INS_LDA_IM, 0x2F, CPU::INS_STA_ZP, 0x00,
+					CPU::INS_JMP_ABS, 0x0B, 0x10 };
+	Banked.cpu.PC = Banked.cpu.LoadPrg(Write, sizeof(Write), Banked.memory);
+	const u32 MapVersion = Banked.memory.MapVersion;
+	const std::string Second = "PC=1007 cycles=20 dump=0000:2\n";
+	const std::string Alone = Serve(Banked, 1, Second);
+
+	// When:
+	const std::string Output = Serve(Banked, 1, "cycles=20\n" + Second);
+
+	// Then:
+	EXPECT_EQ(Banked.memory.MapVersion, MapVersion);
+	EXPECT_EQ(Output.substr(Output.find('\n') + 1), Alone);
+}
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+
+using namespace m6502;
+
+class M6502IdleLoopTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+	Mem memCopy;
+	CPU cpuCopy;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	void LoadCode(const Byte* Code, u32 Size)
+	{
+		for (u32 i = 0; i < Size; i++)
+		{
+			mem[0x1000 + i] = Code[i];
+		}
+		memCopy = mem;
+		cpuCopy = cpu;
+	}
+
+	/* Runs cpuCopy one instruction at a time (nothing is skipped then) like Execute(Cycles) would
+	*	@return the number of cycles that were used */
+	s32 ExecuteOneByOne(s32 Cycles)
+	{
+		s32 CyclesUsed = 0;
+		while (CyclesUsed < Cycles)
+		{
+			CyclesUsed += cpuCopy.Execute(1, memCopy);
+		}
+		return CyclesUsed;
+	}
+
+	void ExpectSameState()
+	{
+		EXPECT_EQ(cpu.PC, cpuCopy.PC);
+		EXPECT_EQ(cpu.A, cpuCopy.A);
+		EXPECT_EQ(cpu.X, cpuCopy.X);
+		EXPECT_EQ(cpu.Y, cpuCopy.Y);
+		EXPECT_EQ(cpu.SP, cpuCopy.SP);
+		EXPECT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg);
+	}
+};
+
+TEST_F(M6502IdleLoopTest, JMPToItselfIsSkippedWithTheSameCycles)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_JMP_ABS, 0x00, 0x10 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(100000, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, ExecuteOneByOne(100000));
+	ExpectSameState();
+#if M6502_IDLE_SKIP
+	EXPECT_GT(cpu.IdleCyclesSkipped, 90000u);
+#endif
+}
+
+TEST_F(M6502IdleLoopTest, PollingLoopRunsOnOnceTheLocationChanges)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_LDA_ABS, 0x00, 0x20,
+					CPU::INS_CMP_IM, 0x01,
+					CPU::INS_BNE, 0xF9,
+					CPU::INS_INY,
+					CPU::INS_JMP_ABS, 0x08, 0x10 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(50001, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, ExecuteOneByOne(50001));
+	ExpectSameState();
+#if M6502_IDLE_SKIP
+	EXPECT_GT(cpu.IdleCyclesSkipped, 0u);
+#endif
+
+	// When:
+	mem[0x2000] = 0x01;
+	cpu.Execute(20, mem);
+
+	// Then:
+	EXPECT_EQ(cpu.Y, 0x01);
+}
+
+TEST_F(M6502IdleLoopTest, DelayLoopsEndWithTheSameStateAsRunningThem)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_LDX_IM, 0xFF,
+					CPU::INS_DEX,
+					CPU::INS_BNE, 0xFD,
+					CPU::INS_LDY_IM, 0x00,
+					CPU::INS_INY,
+					CPU::INS_BNE, 0xFD,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	for (s32 Budget = 1; Budget < 3000; Budget += 97)
+	{
+		const s32 ActualCycles = cpu.Execute(Budget, mem);
+
+		// Then:
+		ASSERT_EQ(ActualCycles, ExecuteOneByOne(Budget));
+		ExpectSameState();
+	}
+#if M6502_IDLE_SKIP
+	EXPECT_GT(cpu.IdleCyclesSkipped, 0u);
+#endif
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include "pch.h"
+#include "main_6502.h"
+#include "pool_6502.h"
+
+using namespace m6502;
+
+class M6502InstancePoolTest : public testing::Test
+{
+public:
+	InstancePool Pool{ 4 };
+
+	virtual void SetUp()
+	{
+
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+};
+
+TEST_F(M6502InstancePoolTest, MachinesAreAlignedAndComeFromFewArenas)
+{
+	// Given:
+	Machine* Machines[10];
+
+	// When:
+	for (Machine*& Each : Machines)
+	{
+		Each = Pool.Acquire();
+	}
+
+	// Then:
+	for (Machine* Each : Machines)
+	{
+		ASSERT_NE(Each, nullptr);
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(Each->memory.Data) % InstancePool::SLOT_ALIGNMENT, 0u);
+	}
+	EXPECT_EQ(Pool.Arenas(), 3u);
+}
+
+TEST_F(M6502InstancePoolTest, ReleasedMachinesComeBackReset)
+{
+	// Given:
+	Machine* First = Pool.Acquire();
+	Byte Rom[Mem::PAGE_SIZE] = { 0xEE };
+	First->cpu.A = 0x42;
+	First->cpu.PC = 0x1234;
+	First->memory.Write(0x2000, 0x11);
+	First->memory.MapRom(0xE0, 1, Rom);
+
+	// When:
+	Pool.Release(First);
+	Machine* Again = Pool.Acquire();
+
+	// Then:
+	EXPECT_EQ(Again, First);
+	EXPECT_EQ(Again->cpu.A, 0x00);
+	EXPECT_EQ(Again->cpu.PC, 0xFFFC);
+	EXPECT_EQ(Again->memory.Read(0x2000), 0x00);
+	EXPECT_TRUE(Again->memory.IsRam(0xE000));
+#if M6502_DIRTY_MAP
+	EXPECT_FALSE(Again->memory.PageDirty(0x20));
+#endif
+	EXPECT_EQ(Pool.Arenas(), 1u);
+}
+
+TEST_F(M6502InstancePoolTest, MachinesOnTheNodeOfTheThreadRunLikeTheOthers)
+{
+	// Given:
+	InstancePool Pool(2, false, InstancePool::CurrentNode());
+
+	// When:
+	Machine* machine = Pool.Acquire();
+
+	// Then:
+	ASSERT_NE(machine, nullptr);
+	EXPECT_GE(InstancePool::CurrentNode(), 0);
+	machine->memory[0x0200] = 0x42;
+	EXPECT_EQ(machine->memory[0x0200], 0x42);
+	EXPECT_EQ(machine->cpu.SP, 0xFF);
+	Pool.Release(machine);
+}
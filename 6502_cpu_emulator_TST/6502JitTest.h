@@ -0,0 +1,204 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "jit_6502.h"
+
+using namespace m6502;
+
+class M6502JitTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+	CPU cpuCopy;
+	Jit jit;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	void CpuMakeCopy()
+	{
+		cpuCopy = cpu;
+	}
+
+	/* LDX #$10 / loop: DEX, STX $0200, LDA $0200, EOR #$FF, CMP #$F0, BNE loop / INY */
+	void LoadCountdownLoop()
+	{
+		cpu.Reset(mem, 0x1000);
+		Byte Code[] = { CPU::INS_LDX_IM, 0x10,
+						CPU::INS_DEX,
+						CPU::INS_STX_ABS, 0x00, 0x02,
+						CPU::INS_LDA_ABS, 0x00, 0x02,
+						CPU::INS_XOR_IM, 0xFF,
+						CPU::INS_CMP_IM, 0xFF,
+						CPU::INS_BNE, 0xF3,
+						CPU::INS_INY,
+						CPU::INS_JMP_ABS, 0x00, 0x10 };
+		for (u32 i = 0; i < sizeof(Code); i++)
+		{
+			mem[0x1000 + i] = Code[i];
+		}
+	}
+};
+
+TEST_F(M6502JitTest, HotLoopsGiveTheSameResultsAsTheInterpreter)
+{
+	// Given:
+	LoadCountdownLoop();
+	Mem memCopy = mem;
+	CpuMakeCopy();
+
+	// When:
+	for (u32 i = 0; i < 200; i++)
+	{
+		const s32 JitCycles = cpu.Execute(13, mem, jit);
+		const s32 InterpretedCycles = cpuCopy.Execute(13, memCopy);
+
+		// Then:
+		ASSERT_EQ(JitCycles, InterpretedCycles);
+		ASSERT_EQ(cpu.PC, cpuCopy.PC);
+		ASSERT_EQ(cpu.A, cpuCopy.A);
+		ASSERT_EQ(cpu.X, cpuCopy.X);
+		ASSERT_EQ(cpu.Y, cpuCopy.Y);
+		ASSERT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg);
+		ASSERT_EQ(mem[0x0200], memCopy[0x0200]);
+	}
+	if (Jit::Available())
+	{
+		EXPECT_GT(jit.CompiledBlocks(), 0u);
+	}
+}
+
+TEST_F(M6502JitTest, CompiledBlocksRespectTheCycleBudget)
+{
+	// Given:
+	LoadCountdownLoop();
+	Mem memCopy = mem;
+	CpuMakeCopy();
+	cpu.Execute(5000, mem, jit);
+	cpuCopy.Execute(5000, memCopy);
+
+	// When:
+	for (s32 Budget = 1; Budget < 40; Budget++)
+	{
+		const s32 JitCycles = cpu.Execute(Budget, mem, jit);
+		const s32 InterpretedCycles = cpuCopy.Execute(Budget, memCopy);
+
+		// Then:
+		ASSERT_EQ(JitCycles, InterpretedCycles);
+		ASSERT_EQ(cpu.PC, cpuCopy.PC);
+	}
+}
+
+TEST_F(M6502JitTest, CompiledLoopsStillSkipIdling)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	Byte Code[] = { CPU::INS_LDA_ABS, 0x00, 0x20,
+					CPU::INS_CMP_IM, 0x01,
+					CPU::INS_BNE, 0xF9,
+					CPU::INS_INY,
+					CPU::INS_JMP_ABS, 0x08, 0x10 };
+	for (u32 i = 0; i < sizeof(Code); i++)
+	{
+		mem[0x1000 + i] = Code[i];
+	}
+	Mem memCopy = mem;
+	CpuMakeCopy();
+	for (u32 i = 0; i < 20; i++)
+	{
+		cpu.Execute(9, mem, jit);
+		cpuCopy.Execute(9, memCopy);
+	}
+	const u64 Skipped = cpu.IdleCyclesSkipped;
+
+	// When:
+	const s32 JitCycles = cpu.Execute(100000, mem, jit);
+
+	// Then:
+	EXPECT_EQ(JitCycles, cpuCopy.Execute(100000, memCopy));
+	EXPECT_EQ(cpu.PC, cpuCopy.PC);
+	EXPECT_EQ(cpu.A, cpuCopy.A);
+	EXPECT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg);
+	if (Jit::Available())
+	{
+		EXPECT_GT(jit.CompiledBlocks(), 0u);
+	}
+#if M6502_IDLE_SKIP
+	EXPECT_GT(cpu.IdleCyclesSkipped, Skipped + 90000u);
+#endif
+}
+
+TEST_F(M6502JitTest, WritingACompiledPageDropsItsCode)
+{
+	// Given:
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_LDA_IM;
+	mem[0x1001] = 0x01;
+	mem[0x1002] = CPU::INS_JMP_ABS;
+	mem[0x1003] = 0x00;
+	mem[0x1004] = 0x10;
+	cpu.Execute(1000, mem, jit);
+	EXPECT_EQ(cpu.A, 0x01);
+
+	// When:
+	mem[0x1001] = 0x80;
+	cpu.Execute(5, mem, jit);
+
+	// Then:
+	EXPECT_EQ(cpu.A, 0x80);
+	EXPECT_TRUE(cpu.PS.Flags.N);
+}
+
+/* Device whose every byte reads $55 */
+struct FiftyFiveDevice : IoDevice
+{
+	Byte Read(Word) override { return 0x55; }
+	void Write(Word, Byte) override {}
+};
+
+TEST_F(M6502JitTest, ABlockCompiledWhenTheCodeArenaIsFullStillSeesItsPagesRemapped)
+{
+	if (!Jit::Available())
+	{
+		return;
+	}
+
+	// Given: LDA $2000 / JMP $1000, whose block is compiled again after every write to its page,
+	// last of all in each Execute, until compiling it is what flushes the full arena
+	cpu.Reset(mem, 0x1000);
+	mem[0x1000] = CPU::INS_LDA_ABS;
+	mem[0x1001] = 0x00;
+	mem[0x1002] = 0x20;
+	mem[0x1003] = CPU::INS_JMP_ABS;
+	mem[0x1004] = 0x00;
+	mem[0x1005] = 0x10;
+	mem[0x2000] = 0x11;
+	constexpr s32 UNTIL_HOT = (Jit::HOT_THRESHOLD - 1) * (4 + 3) + 4;
+	bool Flushed = false;
+	for (u32 i = 0; i < 1000000 && !Flushed; i++)
+	{
+		const u32 Compiled = jit.CompiledBlocks();
+		mem[0x10F0] = static_cast<Byte>(i);
+		cpu.PC = 0x1000;
+		cpu.Execute(UNTIL_HOT, mem, jit);
+		Flushed = jit.CompiledBlocks() == 1 && Compiled > 1;
+	}
+	ASSERT_TRUE(Flushed);
+	FiftyFiveDevice Device;
+
+	// When:
+	mem.MapIo(0x20, 1, &Device);
+	cpu.PC = 0x1000;
+	cpu.Execute(4 + 3, mem, jit);
+
+	// Then:
+	EXPECT_EQ(cpu.A, 0x55);
+}
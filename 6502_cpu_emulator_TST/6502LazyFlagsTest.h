@@ -0,0 +1,86 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+
+using namespace m6502;
+
+class M6502LazyFlagsTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	void LoadCode(const Byte* Code, u32 Size)
+	{
+		for (u32 i = 0; i < Size; i++)
+		{
+			mem[0x1000 + i] = Code[i];
+		}
+	}
+};
+
+TEST_F(M6502LazyFlagsTest, StatusIsUpToDateWhenExecuteReturns)
+{
+	// Given:
+	cpu.PS.Flags.V = 1;
+	Byte Code[] = { CPU::INS_LDA_IM, 0x7F,
+					CPU::INS_ADC_IM, 0x01,
+					CPU::INS_CMP_IM, 0x10 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	cpu.Execute(2 + 2 + 2, mem);
+
+	// Then:
+	EXPECT_EQ(cpu.A, 0x80);
+	EXPECT_FALSE(cpu.PS.Flags.Z);
+	EXPECT_FALSE(cpu.PS.Flags.N);
+	EXPECT_TRUE(cpu.PS.Flags.C);
+	EXPECT_TRUE(cpu.PS.Flags.V);
+}
+
+TEST_F(M6502LazyFlagsTest, PHPPushesTheFlagsOfThePreviousInstruction)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_LDA_IM, 0x00,
+					CPU::INS_PHP };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	cpu.Execute(2 + 3, mem);
+
+	// Then:
+	EXPECT_EQ(mem[0x01FF] & 0x82, 0x02);
+}
+
+TEST_F(M6502LazyFlagsTest, BranchesSeeFlagsThatWereNotWrittenBack)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_LDX_IM, 0x03,
+					CPU::INS_CMX_IM, 0x03,
+					CPU::INS_BEQ, 0x02,
+					CPU::INS_LDY_IM, 0x01,
+					CPU::INS_LDA_IM, 0xFF,
+					CPU::INS_BMI, 0x02,
+					CPU::INS_LDY_IM, 0x02 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	cpu.Execute(2 + 2 + 3 + 2 + 3, mem);
+
+	// Then:
+	EXPECT_EQ(cpu.PC, 0x100E);
+	EXPECT_EQ(cpu.Y, 0x00);
+	EXPECT_TRUE(cpu.PS.Flags.N);
+	EXPECT_TRUE(cpu.PS.Flags.C);
+}
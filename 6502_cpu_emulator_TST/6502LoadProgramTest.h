@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdio>
+#include <string>
 #include "pch.h"
 #include "main_6502.h"
 
@@ -21,6 +23,16 @@ public:
 
 	}
 
+	/* @return the path of a new file holding Size bytes of Bytes */
+	static std::string WriteFile(const char* Name, const Byte* Bytes, u32 Size)
+	{
+		const std::string Path = testing::TempDir() + Name;
+		FILE* File = fopen(Path.c_str(), "wb");
+		fwrite(Bytes, 1, Size, File);
+		fclose(File);
+		return Path;
+	}
+
 	void CpuMakeCopy()
 	{
 		cpuCopy = cpu;
@@ -75,4 +87,74 @@ TEST_F(M6502LoadProgramTest, TestLoadAProgramAndExecuteIt)
 	}
 
 	// then: ???
-}
\ No newline at end of file
+}
+
+TEST_F(M6502LoadProgramTest, LoadingAProgramCountsItsPagesAsWritten)
+{
+	// Given:
+	Byte prg[] = { 0xFE, 0x10, 0xA9, 0xFF, 0x85, 0x90 };
+	const u32 Version = mem.PageVersion[0x11];
+
+	// When:
+	cpu.LoadPrg(prg, sizeof(prg), mem);
+
+	// Then:
+	EXPECT_EQ(mem[0x10FE], 0xA9);
+	EXPECT_EQ(mem[0x1101], 0x90);
+	EXPECT_NE(mem.PageVersion[0x11], Version);
+}
+
+TEST_F(M6502LoadProgramTest, BytesPastTheEndOfTheMemoryAreDropped)
+{
+	// Given:
+	Byte prg[] = { 0xFE, 0xFF, 0x11, 0x22, 0x33 };
+
+	// When:
+	cpu.LoadPrg(prg, sizeof(prg), mem);
+
+	// Then:
+	EXPECT_EQ(mem[0xFFFE], 0x11);
+	EXPECT_EQ(mem[0xFFFF], 0x22);
+	EXPECT_EQ(mem[0x0000], 0x00);
+}
+
+TEST_F(M6502LoadProgramTest, LoadAProgramFromAFile)
+{
+	// Given:
+	Byte prg[] = { 0x00, 0x10, 0xa9, 0xff, 0x85, 0x90 };
+	const std::string Path = WriteFile("m6502_load.prg", prg, sizeof(prg));
+	Word LoadAddress = 0;
+
+	// When:
+	const bool Loaded = cpu.LoadPrgFile(Path.c_str(), mem, LoadAddress);
+
+	// Then:
+	EXPECT_TRUE(Loaded);
+	EXPECT_EQ(LoadAddress, 0x1000);
+	EXPECT_EQ(mem[0x1000], 0xA9);
+	EXPECT_EQ(mem[0x1003], 0x90);
+}
+
+TEST_F(M6502LoadProgramTest, FilesThatAreMissingEmptyOrTooLongAreRefused)
+{
+	// Given:
+	Byte Wraps[] = { 0xFF, 0xFF, 0x11, 0x22 };
+	Byte NoBytes[] = { 0x00, 0x10 };
+	const std::string WrapsPath = WriteFile("m6502_wraps.prg", Wraps, sizeof(Wraps));
+	const std::string NoBytesPath = WriteFile("m6502_nobytes.prg", NoBytes, sizeof(NoBytes));
+	const std::string EmptyPath = WriteFile("m6502_empty.prg", NoBytes, 0);
+	Word LoadAddress = 0;
+
+	// When:
+	const bool LoadedWraps = cpu.LoadPrgFile(WrapsPath.c_str(), mem, LoadAddress);
+	const bool LoadedNoBytes = cpu.LoadPrgFile(NoBytesPath.c_str(), mem, LoadAddress);
+	const bool LoadedEmpty = cpu.LoadPrgFile(EmptyPath.c_str(), mem, LoadAddress);
+	const bool LoadedMissing = cpu.LoadPrgFile((testing::TempDir() + "m6502_missing.prg").c_str(), mem, LoadAddress);
+
+	// Then:
+	EXPECT_FALSE(LoadedWraps);
+	EXPECT_FALSE(LoadedNoBytes);
+	EXPECT_FALSE(LoadedEmpty);
+	EXPECT_FALSE(LoadedMissing);
+	EXPECT_EQ(mem[0xFFFF], 0x00);
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "lockstep_6502.h"
+#include "opcode_info_6502.h"
+#include <memory>
+
+using namespace m6502;
+
+class M6502LockstepTest : public testing::Test
+{
+public:
+	/* Sums X into $90 16 times; when the sum is a multiple of 4 it skips the INC and the
+	*	subroutine (stack), every pass reads through the pointer at $92 (indirect) */
+	Byte Prg[39] = { 0x00, 0x10,
+					CPU::INS_LDY_IM, 0x10,			// $1000
+					CPU::INS_TXA,					// $1002
+					CPU::INS_ADC_ZP, 0x90,
+					CPU::INS_STA_ZP, 0x90,
+					CPU::INS_AND_IM, 0x03,
+					CPU::INS_BEQ, 0x06,
+					CPU::INS_INC_ABSX, 0xFC, 0x02,
+					CPU::INS_JSR, 0x20, 0x10,
+					CPU::INS_LDA_INDY, 0x92,		// $1011
+					CPU::INS_DEY,
+					CPU::INS_BNE, 0xEC,
+					CPU::INS_JMP_ABS, 0x00, 0x10,
+					CPU::INS_NOP, CPU::INS_NOP, CPU::INS_NOP, CPU::INS_NOP,
+					CPU::INS_NOP, CPU::INS_NOP, CPU::INS_NOP,
+					CPU::INS_PHA,					// $1020
+					CPU::INS_INC_ZP, 0x91,
+					CPU::INS_PLA,
+					CPU::INS_RTS };
+
+	virtual void SetUp()
+	{
+
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	/* Loads Prg in memory and starts cpu on it with lane i's inputs */
+	void Boot(u32 i, CPU& cpu, Mem& memory)
+	{
+		cpu.Reset(memory, 0x1000);
+		cpu.LoadPrg(Prg, sizeof(Prg), memory);
+		cpu.X = static_cast<Byte>(i * 7);
+		memory[0x0092] = 0x00;
+		memory[0x0093] = 0x03;
+		for (u32 Offset = 0; Offset < 0x20; Offset++)
+		{
+			memory[0x0300 + Offset] = static_cast<Byte>(i * 31 + Offset * 5);
+		}
+		if (i == 5)
+		{
+			memory[0x1004] = 0x91;		// ADC $91: the code differs from the other lanes
+		}
+	}
+};
+
+TEST_F(M6502LockstepTest, EveryLaneEndsAsIfItRanAlone)
+{
+	// Given:
+	std::unique_ptr<Lockstep> lockstep(new Lockstep());
+	std::vector<std::unique_ptr<Mem>> Memories;
+	for (u32 i = 0; i < Lockstep::MAX_LANES; i++)
+	{
+		CPU cpu;
+		Memories.emplace_back(new Mem());
+		Boot(i, cpu, *Memories.back());
+		EXPECT_EQ(lockstep->AddLane(cpu, *Memories.back()), i);
+	}
+	CPU cpu;
+	Mem mem;
+	EXPECT_EQ(lockstep->AddLane(cpu, mem), Lockstep::MAX_LANES);
+
+	// When:
+	lockstep->Execute(1000);
+	lockstep->Execute(1777);
+
+	// Then:
+	for (u32 i = 0; i < Lockstep::MAX_LANES; i++)
+	{
+		Mem Alone;
+		CPU Expected;
+		Boot(i, Expected, Alone);
+		Expected.Execute(1000, Alone);
+		const s32 Cycles = Expected.Execute(1777, Alone);
+
+		CPU Lane;
+		lockstep->GetLane(i, Lane);
+		EXPECT_EQ(lockstep->Used[i], Cycles);
+		EXPECT_EQ(Lane.PC, Expected.PC);
+		EXPECT_EQ(Lane.SP, Expected.SP);
+		EXPECT_EQ(Lane.A, Expected.A);
+		EXPECT_EQ(Lane.X, Expected.X);
+		EXPECT_EQ(Lane.Y, Expected.Y);
+		EXPECT_EQ(Lane.PS.Reg, Expected.PS.Reg);
+		for (u32 Address = 0; Address < 0x400; Address++)
+		{
+			ASSERT_EQ((*Memories[i])[Address], Alone[Address]) << "lane " << i << " at " << Address;
+		}
+	}
+	EXPECT_GT(lockstep->GroupSteps, 0u);
+	EXPECT_GT(lockstep->LaneSteps, 0u);
+}
+
+TEST_F(M6502LockstepTest, LanesOnTheSameCodeRunEachInstructionOnce)
+{
+	// Given:
+	std::unique_ptr<Lockstep> lockstep(new Lockstep());
+	Byte Loop[] = { 0x00, 0x10, CPU::INS_INX, CPU::INS_TXA, CPU::INS_ADC_IM, 0x11, CPU::INS_JMP_ABS, 0x00, 0x10 };
+	std::vector<std::unique_ptr<Mem>> Memories;
+	for (u32 i = 0; i < 8; i++)
+	{
+		CPU cpu;
+		Memories.emplace_back(new Mem());
+		cpu.Reset(*Memories.back(), 0x1000);
+		cpu.LoadPrg(Loop, sizeof(Loop), *Memories.back());
+		cpu.X = static_cast<Byte>(i);
+		lockstep->AddLane(cpu, *Memories.back());
+	}
+
+	// When:
+	lockstep->Execute(9 * 30);		// 30 passes of 9 cycles
+
+	// Then:
+	EXPECT_EQ(lockstep->GroupSteps, 4u * 30);
+	EXPECT_EQ(lockstep->LaneSteps, 0u);
+	for (u32 i = 0; i < 8; i++)
+	{
+		CPU Lane;
+		lockstep->GetLane(i, Lane);
+		EXPECT_EQ(Lane.X, static_cast<Byte>(i + 30));
+		EXPECT_EQ(lockstep->Used[i], 9 * 30);
+	}
+}
+
+TEST_F(M6502LockstepTest, EveryHandledOpcodeRunsLikeTheInterpreter)
+{
+	for (u32 Opcode = 0; Opcode < 256; Opcode++)
+	{
+		if (!OpcodeTable[Opcode].Handled)
+		{
+			continue;
+		}
+
+		// Given: the instruction at $1000 on 4 lanes with registers, flags, stack and data of their own
+		std::unique_ptr<Lockstep> lockstep(new Lockstep());
+		std::vector<std::unique_ptr<Mem>> Memories;
+		std::vector<CPU> Expected(4);
+		std::vector<Mem> Alone(4);
+		for (u32 i = 0; i < 4; i++)
+		{
+			CPU cpu;
+			Memories.emplace_back(new Mem());
+			Mem& memory = *Memories.back();
+			cpu.Reset(memory, 0x1000);
+			memory[0x1000] = static_cast<Byte>(Opcode);
+			memory[0x1001] = 0x80;
+			memory[0x1002] = 0x02;
+			for (u32 Address = 0; Address < 0x100; Address++)
+			{
+				memory[0x0000 + Address] = static_cast<Byte>(Address * 3 + i * 101);
+				memory[0x0100 + Address] = static_cast<Byte>(Address * 5 + i * 71);
+				memory[0x0280 + Address] = static_cast<Byte>(Address * 7 + i * 67);
+			}
+			cpu.A = static_cast<Byte>(0x40 * i + 0x3F);
+			cpu.X = static_cast<Byte>(i * 0x55);
+			cpu.Y = static_cast<Byte>(0xF0 - i * 0x31);
+			cpu.SP = static_cast<Byte>(0xF0 - i * 0x10);
+			cpu.PS.Reg = static_cast<Byte>(i * 0x47);
+			lockstep->AddLane(cpu, memory);
+			Expected[i] = cpu;
+			Alone[i] = memory;
+		}
+
+		// When:
+		lockstep->Execute(1);
+
+		// Then:
+		for (u32 i = 0; i < 4; i++)
+		{
+			const s32 Cycles = Expected[i].Execute(1, Alone[i]);
+			CPU Lane;
+			lockstep->GetLane(i, Lane);
+			ASSERT_EQ(lockstep->Used[i], Cycles) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(Lane.PC, Expected[i].PC) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(Lane.SP, Expected[i].SP) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(Lane.A, Expected[i].A) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(Lane.X, Expected[i].X) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(Lane.Y, Expected[i].Y) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(Lane.PS.Reg, Expected[i].PS.Reg) << "opcode " << Opcode << " lane " << i;
+			ASSERT_EQ(std::memcmp(Memories[i]->Data, Alone[i].Data, 0x400), 0) << "opcode " << Opcode << " lane " << i;
+		}
+	}
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "jit_6502.h"
+
+using namespace m6502;
+
+/* Device that returns Address's low byte plus the number of reads, and remembers the last write */
+struct CountingDevice : IoDevice
+{
+	u32 Reads = 0;
+	u32 Writes = 0;
+	Word LastAddress = 0;
+	Byte LastValue = 0;
+
+	Byte Read(Word Address) override
+	{
+		LastAddress = Address;
+		return static_cast<Byte>(Address + Reads++);
+	}
+
+	void Write(Word Address, Byte Value) override
+	{
+		Writes++;
+		LastAddress = Address;
+		LastValue = Value;
+	}
+};
+
+class M6502MemoryMapTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+	Byte Rom[Mem::PAGE_SIZE * 2];
+	CountingDevice Device;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+		for (u32 i = 0; i < sizeof(Rom); i++)
+		{
+			Rom[i] = static_cast<Byte>(0xFF - i);
+		}
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	void LoadCode(const Byte* Code, u32 Size)
+	{
+		for (u32 i = 0; i < Size; i++)
+		{
+			mem[0x1000 + i] = Code[i];
+		}
+	}
+};
+
+TEST_F(M6502MemoryMapTest, ROMPagesAreReadFromTheImageAndWrittenToTheRAMUnderneath)
+{
+	// Given:
+	mem.MapRom(0xA0, 2, Rom);
+	Byte Code[] = { CPU::INS_LDA_ABS, 0x01, 0xA1,
+					CPU::INS_STA_ABS, 0x01, 0xA1,
+					CPU::INS_LDX_ABS, 0x01, 0xA1 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	cpu.Execute(12, mem);
+
+	// Then:
+	EXPECT_EQ(cpu.A, Rom[0x101]);
+	EXPECT_EQ(cpu.X, Rom[0x101]);
+	EXPECT_EQ(mem[0xA101], Rom[0x101]);
+	EXPECT_FALSE(mem.IsRam(0xA101));
+
+	// When:
+	mem.MapRam(0xA0, 2);
+
+	// Then:
+	EXPECT_EQ(mem.Read(0xA101), Rom[0x101]);
+	EXPECT_TRUE(mem.IsRam(0xA101));
+}
+
+TEST_F(M6502MemoryMapTest, IOPagesGoToTheirDevice)
+{
+	// Given:
+	mem.MapIo(0xD0, 4, &Device);
+	Byte Code[] = { CPU::INS_LDA_ABS, 0x12, 0xD0,
+					CPU::INS_STA_ABS, 0x20, 0xD3,
+					CPU::INS_INC_ABS, 0x21, 0xD3 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	cpu.Execute(14, mem);
+
+	// Then:
+	EXPECT_EQ(cpu.A, 0x12);
+	EXPECT_EQ(Device.Reads, 2u);
+	EXPECT_EQ(Device.Writes, 2u);
+	EXPECT_EQ(Device.LastAddress, 0xD321);
+	EXPECT_EQ(Device.LastValue, 0x23);
+	EXPECT_EQ(mem[0xD321], 0x00);
+}
+
+TEST_F(M6502MemoryMapTest, WritesToADeviceLeaveItsPageAlone)
+{
+	// Given:
+	mem.MapIo(0xD0, 1, &Device);
+	mem.ClearDirty();
+	const u32 Version = mem.PageVersion[0xD0];
+
+	// When:
+	mem.Write(0xD000, 0x44);
+
+	// Then:
+	EXPECT_EQ(Device.LastValue, 0x44);
+	EXPECT_EQ(mem.PageVersion[0xD0], Version);
+	EXPECT_FALSE(mem.ByteDirty(0xD000));
+}
+
+TEST_F(M6502MemoryMapTest, CopiesUseTheirOwnRAMAndShareROMAndDevices)
+{
+	// Given:
+	mem.MapRom(0xA0, 1, Rom);
+	mem.MapIo(0xD0, 1, &Device);
+	mem[0x2000] = 0x11;
+
+	// When:
+	Mem memCopy = mem;
+	mem[0x2000] = 0x22;
+	memCopy.Write(0xA000, 0x33);
+	memCopy.Write(0xD000, 0x44);
+
+	// Then:
+	EXPECT_EQ(memCopy.Read(0x2000), 0x11);
+	EXPECT_EQ(mem.Read(0x2000), 0x22);
+	EXPECT_EQ(memCopy.Read(0xA000), Rom[0]);
+	EXPECT_EQ(memCopy[0xA000], 0x33);
+	EXPECT_EQ(mem[0xA000], 0x00);
+	EXPECT_EQ(Device.LastValue, 0x44);
+}
+
+TEST_F(M6502MemoryMapTest, CompiledCodeLeavesIOToTheDevice)
+{
+	// Given:
+	Jit jit;
+	mem.MapIo(0xD0, 1, &Device);
+	Byte Code[] = { CPU::INS_LDA_ABS, 0x12, 0xD0,
+					CPU::INS_STA_ABS, 0x13, 0xD0,
+					CPU::INS_JMP_ABS, 0x00, 0x10 };
+	LoadCode(Code, sizeof(Code));
+
+	// When:
+	for (u32 i = 0; i < 100; i++)
+	{
+		cpu.Execute(11, mem, jit);
+	}
+
+	// Then:
+	EXPECT_EQ(Device.Reads, 100u);
+	EXPECT_EQ(Device.Writes, 100u);
+}
+
+TEST_F(M6502MemoryMapTest, ResetOnlyClearsThePagesWrittenSinceTheLastOne)
+{
+	// Given:
+	mem[0x2000] = 0x11;
+	mem.Write(0x3000, 0x22);
+	Mem copy = mem;
+	const u32 UntouchedVersion = mem.PageVersion[0x40];
+
+	// When:
+	cpu.Reset(mem);
+	cpu.Reset(copy);
+
+	// Then:
+	EXPECT_EQ(mem[0x2000], 0x00);
+	EXPECT_EQ(mem[0x3000], 0x00);
+	EXPECT_EQ(copy[0x2000], 0x00);
+	EXPECT_EQ(copy[0x3000], 0x00);
+	EXPECT_EQ(mem.PageVersion[0x40], UntouchedVersion);
+}
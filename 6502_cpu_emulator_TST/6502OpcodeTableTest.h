@@ -0,0 +1,85 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "opcode_info_6502.h"
+
+using namespace m6502;
+
+class M6502OpcodeTableTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+};
+
+TEST_F(M6502OpcodeTableTest, EveryHandledOpcodeUsesItsBaseCyclesWithoutPenalties)
+{
+	for (u32 Opcode = 0; Opcode < 256; Opcode++)
+	{
+		const OpcodeInfo& Info = OpcodeTable[static_cast<Byte>(Opcode)];
+		if (!Info.Handled)
+		{
+			continue;
+		}
+
+		// Given:
+		cpu.Reset(mem, 0x1000);
+		mem[0x1000] = static_cast<Byte>(Opcode);
+		mem[0x1001] = 0x10;
+		mem[0x1002] = 0x20;
+		cpu.PS.Reg = (Info.Mode == AddressingMode::Relative) ? (Opcode & 0x20 ? 0x00 : 0xFF) : 0x00;
+
+		// When:
+		const s32 ActualCycles = cpu.Execute(1, mem);
+
+		// Then:
+		EXPECT_EQ(ActualCycles, Info.Cycles) << Info.Mnemonic << " opcode " << Opcode;
+		const std::string Mnemonic = Info.Mnemonic;
+		if (Mnemonic != "JMP" && Mnemonic != "JSR" && Mnemonic != "RTS")
+		{
+			EXPECT_EQ(cpu.PC, 0x1000 + Info.Length) << Info.Mnemonic << " opcode " << Opcode;
+		}
+	}
+}
+
+TEST_F(M6502OpcodeTableTest, TakenBranchesAddTheirPenalties)
+{
+	// Given:
+	cpu.Reset(mem, 0x10F0);
+	mem[0x10F0] = CPU::INS_BEQ;
+	mem[0x10F1] = 0x20;
+	cpu.PS.Flags.Z = 1;
+	const OpcodeInfo& Info = OpcodeTable[CPU::INS_BEQ];
+	const s32 EXPECTED_CYCLES = Info.Cycles + Info.BranchPenalty + Info.PageCrossPenalty;
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(1, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
+	EXPECT_EQ(cpu.PC, 0x1112);
+}
+
+TEST_F(M6502OpcodeTableTest, UnhandledOpcodesAreDescribedAsSuch)
+{
+	// Given:
+	const OpcodeInfo& Info = OpcodeTable[0x02];
+
+	// Then:
+	EXPECT_FALSE(Info.Handled);
+	EXPECT_STREQ(Info.Mnemonic, "???");
+	EXPECT_EQ(Info.Length, 1);
+	EXPECT_TRUE(OpcodeTable[CPU::INS_LDA_ABSX].Handled);
+	EXPECT_EQ(OpcodeTable[CPU::INS_LDA_ABSX].PageCrossPenalty, 1);
+	EXPECT_EQ(OpcodeTable[CPU::INS_STA_ABSX].PageCrossPenalty, 0);
+}
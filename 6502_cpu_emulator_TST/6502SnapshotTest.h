@@ -0,0 +1,76 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "snapshot_6502.h"
+
+using namespace m6502;
+
+class M6502SnapshotTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+};
+
+TEST_F(M6502SnapshotTest, RestoreBringsBackTheRAMAndOnlyTouchesWhatChanged)
+{
+	// Given:
+	mem[0x2000] = 0x11;
+	MemSnapshot Snapshot(mem);
+	mem[0x2000] = 0x22;
+	mem[0x3000] = 0x33;
+	const u32 UntouchedVersion = mem.PageVersion[0x40];
+
+	// When:
+	Snapshot.Restore(mem);
+
+	// Then:
+	EXPECT_EQ(mem[0x2000], 0x11);
+	EXPECT_EQ(mem[0x3000], 0x00);
+	EXPECT_EQ(Snapshot[0x2000], 0x11);
+	EXPECT_EQ(mem.PageVersion[0x40], UntouchedVersion);
+}
+
+TEST_F(M6502SnapshotTest, SnapshotsOnlyCopyThePagesWrittenSinceThePreviousOne)
+{
+	// Given:
+	Byte Code[] = { CPU::INS_LDA_IM, 0x42,
+					CPU::INS_STA_ABS, 0x00, 0x20 };
+	for (u32 i = 0; i < sizeof(Code); i++)
+	{
+		mem[0x1000 + i] = Code[i];
+	}
+	MemSnapshot Before(mem);
+
+	// When:
+	cpu.Execute(2 + 4, mem);
+	MemSnapshot After(mem, Before);
+
+	// Then:
+	EXPECT_EQ(After.SharedPages(Before), Mem::NUM_PAGES - 1);
+	EXPECT_EQ(Before[0x2000], 0x00);
+	EXPECT_EQ(After[0x2000], 0x42);
+}
+
+TEST_F(M6502SnapshotTest, SnapshotsOfAnotherMemShareNothing)
+{
+	// Given:
+	Mem other;
+	MemSnapshot OfOther(other);
+
+	// When:
+	MemSnapshot Snapshot(mem, OfOther);
+
+	// Then:
+	EXPECT_EQ(Snapshot.SharedPages(OfOther), 0u);
+}
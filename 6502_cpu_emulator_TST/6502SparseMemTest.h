@@ -0,0 +1,81 @@
+#pragma once
+#include "pch.h"
+#include "main_6502.h"
+#include "sparse_mem_6502.h"
+
+using namespace m6502;
+
+class M6502SparseMemTest : public testing::Test
+{
+public:
+	Mem mem;
+	CPU cpu;
+
+	virtual void SetUp()
+	{
+		cpu.Reset(mem, 0x1000);
+	}
+
+	virtual void TearDown()
+	{
+
+	}
+
+	/* A program that stores A at $2000 and increments $90 */
+	static void LoadCode(SparseMem& Ram, Byte Value)
+	{
+		Byte Code[] = { CPU::INS_LDA_IM, Value,
+						CPU::INS_STA_ABS, 0x00, 0x20,
+						CPU::INS_INC_ZP, 0x90 };
+		for (u32 i = 0; i < sizeof(Code); i++)
+		{
+			Ram.Write(static_cast<Word>(0x1000 + i), Code[i]);
+		}
+	}
+};
+
+TEST_F(M6502SparseMemTest, OnlyPagesWrittenWithSomethingButZerosAreAllocated)
+{
+	// Given:
+	SparseMem Ram;
+
+	// When:
+	Ram.Write(0x3000, 0x00);
+	Ram.Write(0x4000, 0x42);
+	Ram.Write(0x4001, 0x00);
+
+	// Then:
+	EXPECT_EQ(Ram.AllocatedPages(), 1u);
+	EXPECT_EQ(Ram[0x3000], 0x00);
+	EXPECT_EQ(Ram[0x4000], 0x42);
+	EXPECT_LT(Ram.Footprint(), Mem::PAGE_SIZE * 4);
+}
+
+TEST_F(M6502SparseMemTest, InstancesTakeTurnsInOneMemAndKeepTheirRAM)
+{
+	// Given:
+	SparseMem First;
+	SparseMem Second;
+	LoadCode(First, 0x11);
+	LoadCode(Second, 0x22);
+	mem[0x5000] = 0x55;
+
+	// When:
+	cpu.Reset(mem, 0x1000);
+	First.Load(mem);
+	cpu.Execute(2 + 4 + 5, mem);
+	First.Store(mem);
+	cpu.Reset(mem, 0x1000);
+	Second.Load(mem);
+	cpu.Execute(2 + 4 + 5, mem);
+	Second.Store(mem);
+	First.Load(mem);
+
+	// Then:
+	EXPECT_EQ(First[0x2000], 0x11);
+	EXPECT_EQ(First[0x0090], 0x01);
+	EXPECT_EQ(Second[0x2000], 0x22);
+	EXPECT_EQ(First.AllocatedPages(), 3u);
+	EXPECT_EQ(mem[0x2000], 0x11);
+	EXPECT_EQ(mem[0x5000], 0x00);
+}
@@ -159,4 +159,27 @@ TEST_F(M6502StatusFlagsTest, NOPDNothing)
 	// Then:
 	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
 	EXPECT_EQ(cpu.PS.Reg, cpuCopy.PS.Reg);
-}
\ No newline at end of file
+}
+
+TEST_F(M6502StatusFlagsTest, PHPAndPLPKeepEveryBitOfTheStatusRegister)
+{
+	// Given:
+	cpu.Reset(mem, 0xFF00);
+	cpu.PS.Reg = 0b11101101;
+	mem[0xFF00] = CPU::INS_PHP;
+	mem[0xFF01] = CPU::INS_LDA_IM;
+	mem[0xFF02] = 0x01;
+	mem[0xFF03] = CPU::INS_CLC;
+	mem[0xFF04] = CPU::INS_PLP;
+	const s32 EXPECTED_CYCLES = 3 + 2 + 2 + 4;
+
+	// When:
+	const s32 ActualCycles = cpu.Execute(EXPECTED_CYCLES, mem);
+
+	// Then:
+	EXPECT_EQ(ActualCycles, EXPECTED_CYCLES);
+	EXPECT_EQ(mem[0x01FF], 0b11101101);
+	EXPECT_EQ(cpu.PS.Reg, 0b11101101);
+	EXPECT_TRUE(cpu.PS.Flags.N);
+	EXPECT_TRUE(cpu.PS.Flags.C);
+}
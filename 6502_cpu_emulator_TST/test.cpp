@@ -11,6 +11,22 @@
 #include "6502StatusFlagsTest.h"
 #include "6502ArithmeticOperationsTest.h"
 #include "6502CompareTest.h"
+#include "6502DecodeCacheTest.h"
+#include "6502JitTest.h"
+#include "6502AotTest.h"
+#include "6502OpcodeTableTest.h"
+#include "6502LazyFlagsTest.h"
+#include "6502IdleLoopTest.h"
+#include "6502MemoryMapTest.h"
+#include "6502C64BankingTest.h"
+#include "6502SnapshotTest.h"
+#include "6502DirtyMapTest.h"
+#include "6502SparseMemTest.h"
+#include "6502InstancePoolTest.h"
+#include "6502BatchTest.h"
+#include "6502LockstepTest.h"
+#include "6502CPUPoolTest.h"
+#include "6502ForkServerTest.h"
 
 GTEST_API_ int main(int argc, char** argv)
 {